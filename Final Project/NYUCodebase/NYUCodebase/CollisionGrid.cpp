@@ -0,0 +1,70 @@
+#include "CollisionGrid.h"
+#include <math.h>
+
+CollisionGrid::CollisionGrid() {
+	columns = 0;
+	rows = 0;
+	cellSize = 1.0f;
+}
+
+void CollisionGrid::Resize(int gridColumns, int gridRows, float gridCellSize) {
+	columns = gridColumns;
+	rows = gridRows;
+	cellSize = gridCellSize;
+	cellHead.assign(columns * rows, -1);
+	next.clear();
+}
+
+void CollisionGrid::Clear() {
+	cellHead.assign(columns * rows, -1);
+	next.clear();
+}
+
+void CollisionGrid::Insert(int id, float x, float y) {
+	if ((int)next.size() <= id) {
+		next.resize(id + 1, -1);
+	}
+	int column, row;
+	Cell(x, y, column, row);
+	int cell = row * columns + column;
+	next[id] = cellHead[cell];
+	cellHead[cell] = id;
+}
+
+// every id bucketed in the 3x3 cells around (x, y); results is reused between queries
+void CollisionGrid::Query(float x, float y, std::vector<int> &results) const {
+	results.clear();
+	int column, row;
+	Cell(x, y, column, row);
+	for (int cellRow = row - 1; cellRow <= row + 1; cellRow++) {
+		if (cellRow < 0 || cellRow >= rows) {
+			continue;
+		}
+		for (int cellColumn = column - 1; cellColumn <= column + 1; cellColumn++) {
+			if (cellColumn < 0 || cellColumn >= columns) {
+				continue;
+			}
+			for (int id = cellHead[cellRow * columns + cellColumn]; id != -1; id = next[id]) {
+				results.push_back(id);
+			}
+		}
+	}
+}
+
+// points off the level clamp to the border cells, which keeps neighbours neighbouring
+void CollisionGrid::Cell(float x, float y, int &column, int &row) const {
+	column = (int)floorf(x / cellSize);
+	row = (int)floorf(-y / cellSize);
+	if (column < 0) {
+		column = 0;
+	}
+	else if (column >= columns) {
+		column = columns - 1;
+	}
+	if (row < 0) {
+		row = 0;
+	}
+	else if (row >= rows) {
+		row = rows - 1;
+	}
+}
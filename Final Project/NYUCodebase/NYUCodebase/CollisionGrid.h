@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+// Uniform grid over the level that buckets entity ids by the cell holding their centre,
+// rebuilt every step. Level coordinates run right and down from (0, 0) like the tiles.
+// Cells must be at least as wide as the largest pair of overlapping half-sizes, so every
+// box that can touch a query point sits in its cell or one of the eight around it.
+class CollisionGrid {
+	public:
+		CollisionGrid();
+
+		void Resize(int columns, int rows, float cellSize);
+		void Clear();
+		void Insert(int id, float x, float y);
+		void Query(float x, float y, std::vector<int> &results) const;
+
+		int columns;
+		int rows;
+		float cellSize;
+
+	private:
+		void Cell(float x, float y, int &column, int &row) const;
+
+		std::vector<int> cellHead;
+		std::vector<int> next;
+};
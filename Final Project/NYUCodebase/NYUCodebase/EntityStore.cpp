@@ -0,0 +1,169 @@
+#include "EntityStore.h"
+#ifdef ENTITY_STORE_SSE
+	#include <xmmintrin.h>
+#endif
+
+EntityStore::EntityStore() {
+}
+
+int EntityStore::Add(float entityX, float entityY, float entityVelocityX, float entityVelocityY, unsigned char entityTag) {
+	x.push_back(entityX);
+	y.push_back(entityY);
+	velocityX.push_back(entityVelocityX);
+	velocityY.push_back(entityVelocityY);
+	previousX.push_back(entityX);
+	previousY.push_back(entityY);
+	tag.push_back(entityTag);
+	behavior.push_back(0);
+	timer.push_back(0.0f);
+	grounded.push_back(0);
+	removed.push_back(0);
+	return (int)x.size() - 1;
+}
+
+int EntityStore::Count() const {
+	return (int)x.size();
+}
+
+void EntityStore::Clear() {
+	x.clear();
+	y.clear();
+	velocityX.clear();
+	velocityY.clear();
+	previousX.clear();
+	previousY.clear();
+	tag.clear();
+	behavior.clear();
+	timer.clear();
+	grounded.clear();
+	removed.clear();
+}
+
+// drops removed entities, keeping the survivors in their order
+void EntityStore::Compact() {
+	int count = Count();
+	int kept = 0;
+	for (int i = 0; i < count; i++) {
+		if (removed[i]) {
+			continue;
+		}
+		if (kept != i) {
+			x[kept] = x[i];
+			y[kept] = y[i];
+			velocityX[kept] = velocityX[i];
+			velocityY[kept] = velocityY[i];
+			previousX[kept] = previousX[i];
+			previousY[kept] = previousY[i];
+			tag[kept] = tag[i];
+			behavior[kept] = behavior[i];
+			timer[kept] = timer[i];
+			grounded[kept] = grounded[i];
+			removed[kept] = 0;
+		}
+		kept++;
+	}
+	if (kept == count) {
+		return;
+	}
+	x.resize(kept);
+	y.resize(kept);
+	velocityX.resize(kept);
+	velocityY.resize(kept);
+	previousX.resize(kept);
+	previousY.resize(kept);
+	tag.resize(kept);
+	behavior.resize(kept);
+	timer.resize(kept);
+	grounded.resize(kept);
+	removed.resize(kept);
+}
+
+void EntityStore::SavePositions() {
+	previousX = x;
+	previousY = y;
+}
+
+// The kernels below multiply and add as separate operations in the same order as the
+// scalar tails and as Entity's own update, so every path gives the same bits and headless
+// hashes do not depend on the count or on SSE being available.
+
+// position += velocity * elapsed
+void EntityStore::Integrate(float elapsed) {
+	int count = Count();
+	int i = 0;
+#ifdef ENTITY_STORE_SSE
+	__m128 step = _mm_set1_ps(elapsed);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(&x[i], _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(_mm_loadu_ps(&velocityX[i]), step)));
+		_mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(_mm_loadu_ps(&velocityY[i]), step)));
+	}
+#endif
+	for (; i < count; i++) {
+		x[i] += velocityX[i] * elapsed;
+		y[i] += velocityY[i] * elapsed;
+	}
+}
+
+void EntityStore::IntegrateX(float elapsed) {
+	int count = Count();
+	int i = 0;
+#ifdef ENTITY_STORE_SSE
+	__m128 step = _mm_set1_ps(elapsed);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(&x[i], _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(_mm_loadu_ps(&velocityX[i]), step)));
+	}
+#endif
+	for (; i < count; i++) {
+		x[i] += velocityX[i] * elapsed;
+	}
+}
+
+void EntityStore::IntegrateY(float elapsed) {
+	int count = Count();
+	int i = 0;
+#ifdef ENTITY_STORE_SSE
+	__m128 step = _mm_set1_ps(elapsed);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(_mm_loadu_ps(&velocityY[i]), step)));
+	}
+#endif
+	for (; i < count; i++) {
+		y[i] += velocityY[i] * elapsed;
+	}
+}
+
+// velocityY = lerp(velocityY, 0, elapsed * friction) - gravity * elapsed
+void EntityStore::ApplyGravity(float elapsed, float friction, float gravity) {
+	int count = Count();
+	float t = elapsed * friction;
+	float keep = 1.0f - t;
+	float pull = (0.0f - gravity) * elapsed;
+	int i = 0;
+#ifdef ENTITY_STORE_SSE
+	__m128 keepWide = _mm_set1_ps(keep);
+	__m128 towardZero = _mm_set1_ps(t * 0.0f);
+	__m128 pullWide = _mm_set1_ps(pull);
+	for (; i + 4 <= count; i += 4) {
+		__m128 damped = _mm_add_ps(_mm_mul_ps(keepWide, _mm_loadu_ps(&velocityY[i])), towardZero);
+		_mm_storeu_ps(&velocityY[i], _mm_add_ps(damped, pullWide));
+	}
+#endif
+	for (; i < count; i++) {
+		velocityY[i] = keep * velocityY[i] + t * 0.0f;
+		velocityY[i] += pull;
+	}
+}
+
+void EntityStore::AdvanceTimers(float elapsed) {
+	int count = Count();
+	int i = 0;
+#ifdef ENTITY_STORE_SSE
+	__m128 step = _mm_set1_ps(elapsed);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(&timer[i], _mm_add_ps(_mm_loadu_ps(&timer[i]), step));
+	}
+#endif
+	for (; i < count; i++) {
+		timer[i] += elapsed;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define ENTITY_STORE_SSE
+#endif
+
+// State of many small entities of one kind, one array per field so the per-step velocity
+// and position updates run four entities per SSE instruction. tag, behavior, timer and
+// grounded are free for the owner to use; removed marks entities that Compact drops.
+class EntityStore {
+	public:
+		EntityStore();
+
+		int Add(float x, float y, float velocityX, float velocityY, unsigned char tag);
+		int Count() const;
+		void Clear();
+		void Compact();
+		void SavePositions();
+		void Integrate(float elapsed);
+		void IntegrateX(float elapsed);
+		void IntegrateY(float elapsed);
+		void ApplyGravity(float elapsed, float friction, float gravity);
+		void AdvanceTimers(float elapsed);
+
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> previousX;
+		std::vector<float> previousY;
+		std::vector<unsigned char> tag;
+		std::vector<unsigned char> behavior;
+		std::vector<float> timer;
+		std::vector<unsigned char> grounded;
+		std::vector<unsigned char> removed;
+};
@@ -103,12 +103,69 @@ bool FlareMap::ReadEntityData(std::ifstream &stream) {
 	return true;
 }
 
+bool FlareMap::ReadAnimationData(std::ifstream &stream) {
+	std::string line;
+	while(getline(stream, line)) {
+		if(line == "" || line == "\r") { break; }
+		std::istringstream sStream(line);
+		std::string key,value;
+		getline(sStream, key, '=');
+		getline(sStream, value);
+		if(key == "tile") {
+			std::istringstream lineStream(value);
+			std::string field;
+			FlareMapAnimation animation;
+			getline(lineStream, field, ',');
+			animation.tile = std::atoi(field.c_str()) - 1;
+			getline(lineStream, field, ',');
+			animation.frameDuration = (float)std::atof(field.c_str());
+			while(getline(lineStream, field, ',')) {
+				animation.frames.push_back(std::atoi(field.c_str()) - 1);
+			}
+			if(animation.tile >= 0 && animation.frameDuration > 0.0f && !animation.frames.empty()) {
+				animations.push_back(animation);
+			}
+		}
+	}
+	return true;
+}
+
+bool FlareMap::ReadTilePropertyData(std::ifstream &stream) {
+	std::string line;
+	while(getline(stream, line)) {
+		if(line == "" || line == "\r") { break; }
+		std::istringstream sStream(line);
+		std::string key,value;
+		getline(sStream, key, '=');
+		getline(sStream, value);
+		if(key == "tile") {
+			std::istringstream lineStream(value);
+			std::string field;
+			FlareMapTileProperty property;
+			getline(lineStream, field, ',');
+			property.tile = std::atoi(field.c_str()) - 1;
+			while(getline(lineStream, field, ',')) {
+				if(!field.empty() && field[field.size() - 1] == '\r') {
+					field.erase(field.size() - 1);
+				}
+				property.flags.push_back(field);
+			}
+			if(property.tile >= 0 && !property.flags.empty()) {
+				tileProperties.push_back(property);
+			}
+		}
+	}
+	return true;
+}
+
 void FlareMap::Load(const std::string& fileName) {
 	std::ifstream infile(fileName);
 	if(infile.fail()) {
 		assert(false); // unable to open file
 	}
 	entities.clear();
+	animations.clear();
+	tileProperties.clear();
 	std::string line;
 	while (std::getline(infile, line)) {
 		if(line == "[header]" || line == "[header]\r") {
@@ -119,6 +176,10 @@ void FlareMap::Load(const std::string& fileName) {
 			ReadLayerData(infile);
 		} else if(line == "[ObjectsLayer]" || line == "[ObjectsLayer]\r") {
 			ReadEntityData(infile);
+		} else if(line == "[animations]" || line == "[animations]\r") {
+			ReadAnimationData(infile);
+		} else if(line == "[tileproperties]" || line == "[tileproperties]\r") {
+			ReadTilePropertyData(infile);
 		}
 	}
 }
@@ -9,6 +9,21 @@ struct FlareMapEntity {
 	float y;
 };
 
+// [animations] entries: tile=<tile>,<seconds per frame>,<frame>,<frame>,... with tiles
+// numbered like the layer data.
+struct FlareMapAnimation {
+	int tile;
+	float frameDuration;
+	std::vector<int> frames;
+};
+
+// [tileproperties] entries: tile=<tile>,<flag>,<flag>,... with flag names like solid or
+// lethal, tiles numbered like the layer data.
+struct FlareMapTileProperty {
+	int tile;
+	std::vector<std::string> flags;
+};
+
 class FlareMap {
 	public:
 		FlareMap();
@@ -20,11 +35,15 @@ class FlareMap {
 		int mapHeight;
 		int **mapData;
 		std::vector<FlareMapEntity> entities;
+		std::vector<FlareMapAnimation> animations;
+		std::vector<FlareMapTileProperty> tileProperties;
 	
 	private:
 	
 		bool ReadHeader(std::ifstream &stream);
 		bool ReadLayerData(std::ifstream &stream);
 		bool ReadEntityData(std::ifstream &stream);
+		bool ReadAnimationData(std::ifstream &stream);
+		bool ReadTilePropertyData(std::ifstream &stream);
 	
 };
@@ -0,0 +1,301 @@
+#include "FrameCapture.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+static uint32_t crcTable[256];
+
+static void buildCrcTable() {
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+}
+
+static void putBigEndian(std::vector<unsigned char> &out, uint32_t value) {
+	out.push_back((unsigned char)(value >> 24));
+	out.push_back((unsigned char)(value >> 16));
+	out.push_back((unsigned char)(value >> 8));
+	out.push_back((unsigned char)value);
+}
+
+static void writeChunk(std::ofstream &file, const char *type, const std::vector<unsigned char> &data) {
+	std::vector<unsigned char> chunk;
+	putBigEndian(chunk, (uint32_t)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 4; i < chunk.size(); i++) {
+		crc = crcTable[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+	}
+	putBigEndian(chunk, crc ^ 0xFFFFFFFFu);
+	file.write((const char*)chunk.data(), chunk.size());
+}
+
+FrameCapture::FrameCapture() {
+	active = false;
+	frames = 0;
+	encoderWaits = 0;
+	captureTicks = 0;
+	width = 0;
+	height = 0;
+	format = CAPTURE_PNG;
+	nextFrame = 0;
+	thread = nullptr;
+	mutex = nullptr;
+	jobReady = nullptr;
+	jobDone = nullptr;
+	quit = false;
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		pixelBuffers[i] = 0;
+		pixelBufferFrames[i] = -1;
+	}
+}
+
+bool FrameCapture::Start(int width, int height, CaptureFormat format, const char *path) {
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	this->path = path;
+	if (format == CAPTURE_Y4M) {
+		stream.open(path, std::ios::binary);
+		if (!stream) {
+			std::cerr << "Unable to open capture stream " << path << std::endl;
+			return false;
+		}
+		stream << "YUV4MPEG2 W" << width << " H" << height << " F60:1 Ip A1:1 C420jpeg\n";
+	}
+	buildCrcTable();
+
+	GLsizeiptr size = (GLsizeiptr)width * height * 4;
+	glGenBuffers(CAPTURE_PBO_COUNT, pixelBuffers);
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		pixelBufferFrames[i] = -1;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	mutex = SDL_CreateMutex();
+	jobReady = SDL_CreateCond();
+	jobDone = SDL_CreateCond();
+	quit = false;
+	nextFrame = 0;
+	thread = SDL_CreateThread(Run, "Capture", this);
+	active = true;
+	return true;
+}
+
+void FrameCapture::Capture() {
+	if (!active) {
+		return;
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+	int slot = nextFrame % CAPTURE_PBO_COUNT;
+	// the oldest read in the ring finished frames ago, so mapping it does not wait
+	Collect(slot);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	pixelBufferFrames[slot] = nextFrame++;
+	captureTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void FrameCapture::Collect(int slot) {
+	if (pixelBufferFrames[slot] < 0) {
+		return;
+	}
+	SDL_LockMutex(mutex);
+	if (pending.size() >= CAPTURE_MAX_QUEUED) {
+		encoderWaits++;
+		while (pending.size() >= CAPTURE_MAX_QUEUED) {
+			SDL_CondWait(jobDone, mutex);
+		}
+	}
+	CaptureJob *job;
+	if (freeJobs.empty()) {
+		job = new CaptureJob();
+	}
+	else {
+		job = freeJobs.back();
+		freeJobs.pop_back();
+	}
+	SDL_UnlockMutex(mutex);
+
+	size_t size = (size_t)width * height * 4;
+	job->pixels.resize(size);
+	job->frameIndex = pixelBufferFrames[slot];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+	const unsigned char *mapped = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (mapped != NULL) {
+		memcpy(job->pixels.data(), mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	pixelBufferFrames[slot] = -1;
+
+	SDL_LockMutex(mutex);
+	pending.push_back(job);
+	SDL_CondSignal(jobReady);
+	SDL_UnlockMutex(mutex);
+	frames++;
+}
+
+int FrameCapture::Run(void *data) {
+	((FrameCapture*)data)->Loop();
+	return 0;
+}
+
+void FrameCapture::Loop() {
+	SDL_LockMutex(mutex);
+	while (true) {
+		while (pending.empty() && !quit) {
+			SDL_CondWait(jobReady, mutex);
+		}
+		if (pending.empty()) {
+			break;
+		}
+		CaptureJob *job = pending.front();
+		SDL_UnlockMutex(mutex);
+
+		Encode(*job);
+
+		SDL_LockMutex(mutex);
+		// popped only once written so the queue length also counts the frame in progress
+		pending.pop_front();
+		freeJobs.push_back(job);
+		SDL_CondBroadcast(jobDone);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+void FrameCapture::Encode(const CaptureJob &job) {
+	if (format == CAPTURE_Y4M) {
+		WriteY4m(job);
+	}
+	else {
+		WritePng(job);
+	}
+}
+
+void FrameCapture::WritePng(const CaptureJob &job) {
+	char filePath[512];
+	snprintf(filePath, sizeof(filePath), "%s/frame%05d.png", path.c_str(), job.frameIndex);
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file) {
+		std::cerr << "Unable to write frame " << filePath << std::endl;
+		return;
+	}
+	const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	file.write((const char*)signature, sizeof(signature));
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	// 8 bit RGB, default compression and filtering, no interlace
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	writeChunk(file, "IHDR", header);
+
+	// zlib stream of stored deflate blocks: the worker's time goes to I/O rather than compression
+	size_t rowSize = (size_t)width * 3 + 1;
+	size_t rawSize = rowSize * height;
+	std::vector<unsigned char> &raw = encodeScratch;
+	raw.resize(rawSize);
+	for (int y = 0; y < height; y++) {
+		// GL rows start at the bottom, PNG rows at the top
+		const unsigned char *source = job.pixels.data() + (size_t)(height - 1 - y) * width * 4;
+		unsigned char *row = &raw[y * rowSize];
+		row[0] = 0;
+		for (int x = 0; x < width; x++) {
+			row[1 + x * 3] = source[x * 4];
+			row[2 + x * 3] = source[x * 4 + 1];
+			row[3 + x * 3] = source[x * 4 + 2];
+		}
+	}
+	std::vector<unsigned char> data;
+	data.reserve(rawSize + rawSize / 65535 * 5 + 16);
+	data.push_back(0x78);
+	data.push_back(0x01);
+	for (size_t offset = 0; offset < rawSize; offset += 65535) {
+		size_t length = std::min(rawSize - offset, (size_t)65535);
+		data.push_back(offset + length == rawSize ? 1 : 0);
+		data.push_back((unsigned char)length);
+		data.push_back((unsigned char)(length >> 8));
+		data.push_back((unsigned char)~length);
+		data.push_back((unsigned char)(~length >> 8));
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+	}
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (size_t i = 0; i < rawSize; i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(data, (b << 16) | a);
+	writeChunk(file, "IDAT", data);
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+}
+
+void FrameCapture::WriteY4m(const CaptureJob &job) {
+	// full range BT.601, chroma averaged over 2x2 blocks for 4:2:0
+	int chromaWidth = width / 2;
+	int chromaHeight = height / 2;
+	std::vector<unsigned char> &planes = encodeScratch;
+	planes.resize((size_t)width * height + (size_t)chromaWidth * chromaHeight * 2);
+	unsigned char *lumaPlane = planes.data();
+	unsigned char *uPlane = lumaPlane + (size_t)width * height;
+	unsigned char *vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+	for (int y = 0; y < height; y++) {
+		const unsigned char *source = job.pixels.data() + (size_t)(height - 1 - y) * width * 4;
+		for (int x = 0; x < width; x++) {
+			const unsigned char *pixel = source + x * 4;
+			lumaPlane[y * width + x] = (unsigned char)((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2]) >> 8);
+		}
+	}
+	for (int y = 0; y < chromaHeight; y++) {
+		const unsigned char *top = job.pixels.data() + (size_t)(height - 1 - y * 2) * width * 4;
+		const unsigned char *bottom = top - (size_t)width * 4;
+		for (int x = 0; x < chromaWidth; x++) {
+			int r = top[x * 8] + top[x * 8 + 4] + bottom[x * 8] + bottom[x * 8 + 4];
+			int g = top[x * 8 + 1] + top[x * 8 + 5] + bottom[x * 8 + 1] + bottom[x * 8 + 5];
+			int b = top[x * 8 + 2] + top[x * 8 + 6] + bottom[x * 8 + 2] + bottom[x * 8 + 6];
+			uPlane[y * chromaWidth + x] = (unsigned char)std::min(std::max(128 + ((-43 * r - 85 * g + 128 * b) >> 10), 0), 255);
+			vPlane[y * chromaWidth + x] = (unsigned char)std::min(std::max(128 + ((128 * r - 107 * g - 21 * b) >> 10), 0), 255);
+		}
+	}
+	stream << "FRAME\n";
+	stream.write((const char*)planes.data(), planes.size());
+}
+
+void FrameCapture::Stop() {
+	if (!active) {
+		return;
+	}
+	// hand over the reads still in the ring, oldest first
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		Collect((nextFrame + i) % CAPTURE_PBO_COUNT);
+	}
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondSignal(jobReady);
+	SDL_UnlockMutex(mutex);
+	SDL_WaitThread(thread, nullptr);
+	thread = nullptr;
+	SDL_DestroyCond(jobReady);
+	SDL_DestroyCond(jobDone);
+	SDL_DestroyMutex(mutex);
+	for (size_t i = 0; i < freeJobs.size(); i++) {
+		delete freeJobs[i];
+	}
+	freeJobs.clear();
+	glDeleteBuffers(CAPTURE_PBO_COUNT, pixelBuffers);
+	if (stream.is_open()) {
+		stream.close();
+	}
+	active = false;
+}
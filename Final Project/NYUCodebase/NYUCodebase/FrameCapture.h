@@ -0,0 +1,69 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <SDL.h>
+#include <stdint.h>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define CAPTURE_PBO_COUNT 3
+#define CAPTURE_MAX_QUEUED 8
+
+enum CaptureFormat { CAPTURE_PNG, CAPTURE_Y4M };
+
+struct CaptureJob {
+	std::vector<unsigned char> pixels;
+	int frameIndex;
+};
+
+// Records the bound framebuffer without stalling on it. Each frame's glReadPixels lands in
+// one of CAPTURE_PBO_COUNT pixel buffers and is only mapped CAPTURE_PBO_COUNT - 1 frames
+// later, when the GPU is long done with it. The mapped pixels are copied into a job for a
+// worker thread, which writes them as numbered PNG files or appends them to a Y4M stream.
+// Capture only blocks when the worker falls CAPTURE_MAX_QUEUED frames behind.
+class FrameCapture {
+	public:
+		FrameCapture();
+
+		bool Start(int width, int height, CaptureFormat format, const char *path);
+		void Capture();
+		void Stop();
+
+		bool active;
+		int frames;
+		int encoderWaits;
+		Uint64 captureTicks;
+
+	private:
+		static int Run(void *data);
+		void Loop();
+		void Collect(int slot);
+		void Encode(const CaptureJob &job);
+		void WritePng(const CaptureJob &job);
+		void WriteY4m(const CaptureJob &job);
+
+		int width;
+		int height;
+		CaptureFormat format;
+		std::string path;
+		std::ofstream stream;
+
+		GLuint pixelBuffers[CAPTURE_PBO_COUNT];
+		int pixelBufferFrames[CAPTURE_PBO_COUNT];
+		int nextFrame;
+
+		SDL_Thread *thread;
+		SDL_mutex *mutex;
+		SDL_cond *jobReady;
+		SDL_cond *jobDone;
+		std::deque<CaptureJob*> pending;
+		std::vector<CaptureJob*> freeJobs;
+		bool quit;
+
+		std::vector<unsigned char> encodeScratch;
+};
@@ -0,0 +1,117 @@
+#include "InstanceBatch.h"
+#include <stdio.h>
+
+#define FLOATS_PER_INSTANCE 8
+
+InstanceBatch::InstanceBatch() {
+	quadBuffer = 0;
+	drawCalls = 0;
+	instanceCount = 0;
+	stream = nullptr;
+}
+
+bool InstanceBatch::IsSupported() {
+	static int supported = -1;
+	if (supported < 0) {
+		int major = 0;
+		int minor = 0;
+		const char *version = (const char*)glGetString(GL_VERSION);
+		if (version != NULL) {
+			sscanf(version, "%d.%d", &major, &minor);
+		}
+		supported = (major > 3 || (major == 3 && minor >= 3)) ? 1 : 0;
+	}
+	return supported == 1;
+}
+
+void InstanceBatch::Add(float x, float y, float width, float height, float u, float v, float uWidth, float vHeight) {
+	instanceData.insert(instanceData.end(), { x, y, width, height, u, v, uWidth, vHeight });
+}
+
+void InstanceBatch::Draw(ShaderProgram *program, GLuint textureID) {
+	instanceCount = (int)(instanceData.size() / FLOATS_PER_INSTANCE);
+	if (instanceCount == 0) {
+		return;
+	}
+	Matrix modelMatrix;
+	program->Use();
+	program->SetModelMatrix(modelMatrix);
+	ShaderProgram::BindTexture(textureID);
+	if (IsSupported() && program->instanceRectAttribute >= 0 && program->instanceTexRectAttribute >= 0) {
+		DrawInstanced(program);
+	}
+	else {
+		DrawExpanded(program);
+	}
+	instanceData.clear();
+	drawCalls++;
+}
+
+void InstanceBatch::DrawInstanced(ShaderProgram *program) {
+	if (quadBuffer == 0) {
+		float quad[] = {
+			-0.5f, 0.5f, 0.0f, 0.0f,
+			-0.5f, -0.5f, 0.0f, 1.0f,
+			0.5f, 0.5f, 1.0f, 0.0f,
+			0.5f, -0.5f, 1.0f, 1.0f };
+		glGenBuffers(1, &quadBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(program->positionAttribute);
+	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(program->texCoordAttribute);
+
+	GLsizei stride = FLOATS_PER_INSTANCE * sizeof(float);
+	GLintptr offset = stream->Write(instanceData.data(), instanceData.size() * sizeof(float));
+	glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+	glVertexAttribPointer(program->instanceRectAttribute, 4, GL_FLOAT, false, stride, (void*)offset);
+	glEnableVertexAttribArray(program->instanceRectAttribute);
+	glVertexAttribDivisor(program->instanceRectAttribute, 1);
+	glVertexAttribPointer(program->instanceTexRectAttribute, 4, GL_FLOAT, false, stride, (void*)(offset + 4 * sizeof(float)));
+	glEnableVertexAttribArray(program->instanceTexRectAttribute);
+	glVertexAttribDivisor(program->instanceTexRectAttribute, 1);
+
+	Mesh::BindQuadIndices(1);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0, instanceCount);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glVertexAttribDivisor(program->instanceRectAttribute, 0);
+	glVertexAttribDivisor(program->instanceTexRectAttribute, 0);
+	glDisableVertexAttribArray(program->instanceRectAttribute);
+	glDisableVertexAttribArray(program->instanceTexRectAttribute);
+	glDisableVertexAttribArray(program->positionAttribute);
+	glDisableVertexAttribArray(program->texCoordAttribute);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	program->ResetInstanceAttributes();
+}
+
+void InstanceBatch::DrawExpanded(ShaderProgram *program) {
+	expandedData.resize(instanceCount * MESH_FLOATS_PER_QUAD);
+	for (int i = 0; i < instanceCount; i++) {
+		const float *instance = &instanceData[i * FLOATS_PER_INSTANCE];
+		float left = instance[0] - 0.5f * instance[2];
+		float right = instance[0] + 0.5f * instance[2];
+		float top = instance[1] + 0.5f * instance[3];
+		float bottom = instance[1] - 0.5f * instance[3];
+		float u = instance[4];
+		float v = instance[5];
+		float uWidth = instance[6];
+		float vHeight = instance[7];
+		Mesh::WriteQuad(&expandedData[i * MESH_FLOATS_PER_QUAD], left, top, right, bottom, u, v, uWidth, vHeight);
+	}
+	int firstQuad = stream->WriteQuads(expandedData.data(), instanceCount, MESH_FLOATS_PER_QUAD);
+	expandedMesh.Attach(stream->buffer, stream->QuadCapacity(MESH_FLOATS_PER_QUAD));
+	expandedMesh.Draw(program, firstQuad, instanceCount);
+}
+
+void InstanceBatch::Cleanup() {
+	if (quadBuffer != 0) {
+		glDeleteBuffers(1, &quadBuffer);
+		quadBuffer = 0;
+	}
+	expandedMesh.Cleanup();
+}
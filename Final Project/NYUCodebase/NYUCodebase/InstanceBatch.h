@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "Mesh.h"
+#include "StreamBuffer.h"
+
+// Draws many copies of a unit quad that differ only in position, size and UV rectangle
+// with a single glDrawElementsInstanced over the shared quad indices. Instance data lives in
+// the StreamBuffer, and contexts older than GL 3.3 draw expanded quads from it instead.
+// drawCalls runs from startup; instanceCount is the size of the latest batch.
+class InstanceBatch {
+	public:
+		InstanceBatch();
+
+		void Add(float x, float y, float width, float height, float u, float v, float uWidth, float vHeight);
+		void Draw(ShaderProgram *program, GLuint textureID);
+		void Cleanup();
+
+		static bool IsSupported();
+
+		int drawCalls;
+		int instanceCount;
+		StreamBuffer *stream;
+
+	private:
+		void DrawInstanced(ShaderProgram *program);
+		void DrawExpanded(ShaderProgram *program);
+
+		GLuint quadBuffer;
+		std::vector<float> instanceData;
+		std::vector<float> expandedData;
+		Mesh expandedMesh;
+};
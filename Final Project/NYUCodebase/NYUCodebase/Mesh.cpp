@@ -0,0 +1,230 @@
+#include "Mesh.h"
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include <SDL.h>
+
+GLuint Mesh::quadIndexBuffer = 0;
+int Mesh::quadIndexCapacity = 0;
+
+Mesh::Mesh(MeshFormat format) {
+	this->format = format;
+	quadCapacity = 0;
+	vertexArray = 0;
+	vertexBuffer = 0;
+	ownsBuffer = true;
+	layoutProgram = nullptr;
+}
+
+bool Mesh::VertexArraysSupported() {
+	static int supported = -1;
+	if (supported < 0) {
+		int major = 0;
+		int minor = 0;
+		const char *version = (const char*)glGetString(GL_VERSION);
+		if (version != NULL) {
+			sscanf(version, "%d.%d", &major, &minor);
+		}
+		supported = (major >= 3 || SDL_GL_ExtensionSupported("GL_ARB_vertex_array_object")) ? 1 : 0;
+	}
+	return supported == 1;
+}
+
+int Mesh::FloatsPerQuad() const {
+	switch (format) {
+	case MESH_WRAPPED:
+		return MESH_WRAPPED_FLOATS_PER_QUAD;
+	case MESH_TINTED:
+		return MESH_TINTED_FLOATS_PER_QUAD;
+	default:
+		return MESH_FLOATS_PER_QUAD;
+	}
+}
+
+void Mesh::WriteTintedQuad(float *out, float left, float top, float right, float bottom, float u, float v, float uWidth, float vHeight, const float *tint, float textured) {
+	float quad[] = {
+		left, top, u, v, tint[0], tint[1], tint[2], tint[3], textured,
+		left, bottom, u, v + vHeight, tint[0], tint[1], tint[2], tint[3], textured,
+		right, top, u + uWidth, v, tint[0], tint[1], tint[2], tint[3], textured,
+		right, bottom, u + uWidth, v + vHeight, tint[0], tint[1], tint[2], tint[3], textured };
+	std::copy(quad, quad + MESH_TINTED_FLOATS_PER_QUAD, out);
+}
+
+void Mesh::WriteWrappedQuad(float *out, float left, float top, float right, float bottom, float cellsWide, float cellsHigh, float cellU, float cellV, float cellWidth, float cellHeight, float tile) {
+	float quad[] = {
+		left, top, 0.0f, 0.0f, cellU, cellV, cellWidth, cellHeight, tile,
+		left, bottom, 0.0f, cellsHigh, cellU, cellV, cellWidth, cellHeight, tile,
+		right, top, cellsWide, 0.0f, cellU, cellV, cellWidth, cellHeight, tile,
+		right, bottom, cellsWide, cellsHigh, cellU, cellV, cellWidth, cellHeight, tile };
+	std::copy(quad, quad + MESH_WRAPPED_FLOATS_PER_QUAD, out);
+}
+
+void Mesh::WriteQuad(float *out, float left, float top, float right, float bottom, float u, float v, float uWidth, float vHeight) {
+	float quad[] = {
+		left, top, u, v,
+		left, bottom, u, v + vHeight,
+		right, top, u + uWidth, v,
+		right, bottom, u + uWidth, v + vHeight };
+	std::copy(quad, quad + MESH_FLOATS_PER_QUAD, out);
+}
+
+void Mesh::BindQuadIndices(int quadCount) {
+	if (quadIndexBuffer == 0) {
+		glGenBuffers(1, &quadIndexBuffer);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
+	if (quadCount <= quadIndexCapacity) {
+		return;
+	}
+	int capacity = quadIndexCapacity > 0 ? quadIndexCapacity : 1024;
+	while (capacity < quadCount) {
+		capacity *= 2;
+	}
+	std::vector<GLuint> indices(capacity * 6);
+	for (int quad = 0; quad < capacity; quad++) {
+		GLuint first = quad * 4;
+		GLuint *index = &indices[quad * 6];
+		index[0] = first;
+		index[1] = first + 1;
+		index[2] = first + 2;
+		index[3] = first + 3;
+		index[4] = first + 2;
+		index[5] = first + 1;
+	}
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	quadIndexCapacity = capacity;
+}
+
+void Mesh::Upload(const float *quadData, int quadCount, GLenum usage) {
+	if (vertexBuffer == 0 || !ownsBuffer) {
+		glGenBuffers(1, &vertexBuffer);
+		layoutProgram = nullptr;
+	}
+	// respecifying the whole store also orphans the previous contents for streamed meshes
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, quadCount * FloatsPerQuad() * sizeof(float), quadData, usage);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	ownsBuffer = true;
+	quadCapacity = quadCount;
+}
+
+void Mesh::Attach(GLuint buffer, int quadCapacity) {
+	// draws from a buffer owned elsewhere; the vertex array layout is recorded again whenever it changes
+	if (ownsBuffer && vertexBuffer != 0) {
+		glDeleteBuffers(1, &vertexBuffer);
+	}
+	if (buffer != vertexBuffer || quadCapacity != this->quadCapacity) {
+		layoutProgram = nullptr;
+	}
+	vertexBuffer = buffer;
+	ownsBuffer = false;
+	this->quadCapacity = quadCapacity;
+}
+
+void Mesh::UploadRange(int firstQuad, const float *quadData, int quadCount) {
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)firstQuad * FloatsPerQuad() * sizeof(float), quadCount * FloatsPerQuad() * sizeof(float), quadData);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::SetAttributes(ShaderProgram *program) {
+	GLsizei stride = FloatsPerQuad() / 4 * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, stride, (void*)0);
+	glEnableVertexAttribArray(program->positionAttribute);
+	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, stride, (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(program->texCoordAttribute);
+	if (format == MESH_WRAPPED && program->texCellAttribute >= 0) {
+		glVertexAttribPointer(program->texCellAttribute, 4, GL_FLOAT, false, stride, (void*)(4 * sizeof(float)));
+		glEnableVertexAttribArray(program->texCellAttribute);
+	}
+	if (format == MESH_WRAPPED && program->tileAttribute >= 0) {
+		glVertexAttribPointer(program->tileAttribute, 1, GL_FLOAT, false, stride, (void*)(8 * sizeof(float)));
+		glEnableVertexAttribArray(program->tileAttribute);
+	}
+	if (format == MESH_TINTED && program->tintAttribute >= 0) {
+		glVertexAttribPointer(program->tintAttribute, 4, GL_FLOAT, false, stride, (void*)(4 * sizeof(float)));
+		glEnableVertexAttribArray(program->tintAttribute);
+	}
+	if (format == MESH_TINTED && program->texturedAttribute >= 0) {
+		glVertexAttribPointer(program->texturedAttribute, 1, GL_FLOAT, false, stride, (void*)(8 * sizeof(float)));
+		glEnableVertexAttribArray(program->texturedAttribute);
+	}
+}
+
+void Mesh::Bind(ShaderProgram *program) {
+	BindQuadIndices(quadCapacity);
+	if (!VertexArraysSupported()) {
+		SetAttributes(program);
+		return;
+	}
+	if (vertexArray == 0) {
+		glGenVertexArrays(1, &vertexArray);
+	}
+	glBindVertexArray(vertexArray);
+	if (layoutProgram != program) {
+		// attribute locations belong to the program, so record them again for a new one
+		SetAttributes(program);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
+		layoutProgram = program;
+	}
+}
+
+void Mesh::Unbind(ShaderProgram *program) {
+	if (VertexArraysSupported()) {
+		// back to the default vertex array so client-side array draws keep working
+		glBindVertexArray(0);
+	}
+	else {
+		glDisableVertexAttribArray(program->positionAttribute);
+		glDisableVertexAttribArray(program->texCoordAttribute);
+		if (format == MESH_WRAPPED && program->texCellAttribute >= 0) {
+			glDisableVertexAttribArray(program->texCellAttribute);
+		}
+		if (format == MESH_WRAPPED && program->tileAttribute >= 0) {
+			glDisableVertexAttribArray(program->tileAttribute);
+		}
+		if (format == MESH_TINTED && program->tintAttribute >= 0) {
+			glDisableVertexAttribArray(program->tintAttribute);
+		}
+		if (format == MESH_TINTED && program->texturedAttribute >= 0) {
+			glDisableVertexAttribArray(program->texturedAttribute);
+		}
+	}
+	if (format != MESH_TEXTURED) {
+		program->ResetInstanceAttributes();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Mesh::Draw(ShaderProgram *program, int firstQuad, int quadCount) {
+	if (vertexBuffer == 0 || quadCount <= 0) {
+		return;
+	}
+	Bind(program);
+	glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_INT, (void*)((size_t)firstQuad * 6 * sizeof(GLuint)));
+	Unbind(program);
+}
+
+void Mesh::Cleanup() {
+	if (vertexArray != 0) {
+		glDeleteVertexArrays(1, &vertexArray);
+		vertexArray = 0;
+	}
+	if (vertexBuffer != 0 && ownsBuffer) {
+		glDeleteBuffers(1, &vertexBuffer);
+	}
+	vertexBuffer = 0;
+	ownsBuffer = true;
+	layoutProgram = nullptr;
+	quadCapacity = 0;
+}
+
+void Mesh::CleanupShared() {
+	if (quadIndexBuffer != 0) {
+		glDeleteBuffers(1, &quadIndexBuffer);
+		quadIndexBuffer = 0;
+		quadIndexCapacity = 0;
+	}
+}
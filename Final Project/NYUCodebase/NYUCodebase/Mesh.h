@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include "ShaderProgram.h"
+
+#define MESH_FLOATS_PER_VERTEX 4
+#define MESH_FLOATS_PER_QUAD (MESH_FLOATS_PER_VERTEX * 4)
+#define MESH_WRAPPED_FLOATS_PER_VERTEX 9
+#define MESH_WRAPPED_FLOATS_PER_QUAD (MESH_WRAPPED_FLOATS_PER_VERTEX * 4)
+#define MESH_TINTED_FLOATS_PER_VERTEX 9
+#define MESH_TINTED_FLOATS_PER_QUAD (MESH_TINTED_FLOATS_PER_VERTEX * 4)
+
+// MESH_WRAPPED vertices carry the atlas cell (u, v, width, height) and the tile index as
+// well, and their texture coordinates count cells, so one quad can repeat a cell across
+// several tiles and the shader can swap in an animation frame's cell.
+// MESH_TINTED vertices carry an RGBA tint and a textured flag, 0 for flat colour.
+enum MeshFormat { MESH_TEXTURED, MESH_WRAPPED, MESH_TINTED };
+
+// Quads stored as four interleaved x, y, u, v vertices (top left, bottom left, top right,
+// bottom right) in a GPU buffer and drawn through one static index buffer shared by every
+// mesh. Where vertex array objects are available the attribute layout is recorded once,
+// so a draw is a bind plus glDrawElements.
+class Mesh {
+	public:
+		Mesh(MeshFormat format = MESH_TEXTURED);
+
+		void Upload(const float *quadData, int quadCount, GLenum usage);
+		void UploadRange(int firstQuad, const float *quadData, int quadCount);
+		void Attach(GLuint buffer, int quadCapacity);
+		void Draw(ShaderProgram *program, int firstQuad, int quadCount);
+		void Cleanup();
+
+		int FloatsPerQuad() const;
+
+		static void WriteQuad(float *out, float left, float top, float right, float bottom, float u, float v, float uWidth, float vHeight);
+		static void WriteTintedQuad(float *out, float left, float top, float right, float bottom, float u, float v, float uWidth, float vHeight, const float *tint, float textured);
+		static void WriteWrappedQuad(float *out, float left, float top, float right, float bottom, float cellsWide, float cellsHigh, float cellU, float cellV, float cellWidth, float cellHeight, float tile);
+		static void BindQuadIndices(int quadCount);
+		static bool VertexArraysSupported();
+		static void CleanupShared();
+
+		int quadCapacity;
+
+	private:
+		void Bind(ShaderProgram *program);
+		void Unbind(ShaderProgram *program);
+		void SetAttributes(ShaderProgram *program);
+
+		MeshFormat format;
+		GLuint vertexArray;
+		GLuint vertexBuffer;
+		bool ownsBuffer;
+		ShaderProgram *layoutProgram;
+
+		static GLuint quadIndexBuffer;
+		static int quadIndexCapacity;
+};
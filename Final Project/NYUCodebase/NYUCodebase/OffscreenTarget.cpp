@@ -0,0 +1,82 @@
+#include "OffscreenTarget.h"
+#include <fstream>
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget() {
+	width = 0;
+	height = 0;
+	framebuffer = 0;
+	colorBuffer = 0;
+}
+
+bool OffscreenTarget::Create(int width, int height) {
+	this->width = width;
+	this->height = height;
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Offscreen framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		Cleanup();
+		return false;
+	}
+	return true;
+}
+
+void OffscreenTarget::Bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+void OffscreenTarget::ReadPixels() {
+	pixels.resize((size_t)width * height * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+uint64_t OffscreenTarget::HashFrame() {
+	ReadPixels();
+	// 64-bit FNV-1a over the RGBA bytes
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < pixels.size(); i++) {
+		hash ^= pixels[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool OffscreenTarget::WriteFrame(const char *path) {
+	ReadPixels();
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Unable to write frame " << path << std::endl;
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	// GL rows start at the bottom, PPM rows at the top
+	for (int y = height - 1; y >= 0; y--) {
+		const unsigned char *row = pixels.data() + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++) {
+			file.write((const char*)(row + x * 4), 3);
+		}
+	}
+	return true;
+}
+
+void OffscreenTarget::Cleanup() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+	if (colorBuffer != 0) {
+		glDeleteRenderbuffers(1, &colorBuffer);
+		colorBuffer = 0;
+	}
+}
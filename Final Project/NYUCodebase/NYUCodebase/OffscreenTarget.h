@@ -0,0 +1,32 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <stdint.h>
+#include <vector>
+
+// Colour renderbuffer attached to a framebuffer object, used in headless mode so frames
+// never touch the window's default framebuffer. Frames can be hashed for regression
+// checks or dumped as binary PPM images.
+class OffscreenTarget {
+	public:
+		OffscreenTarget();
+
+		bool Create(int width, int height);
+		void Bind();
+		uint64_t HashFrame();
+		bool WriteFrame(const char *path);
+		void Cleanup();
+
+		int width;
+		int height;
+
+	private:
+		void ReadPixels();
+
+		GLuint framebuffer;
+		GLuint colorBuffer;
+		std::vector<unsigned char> pixels;
+};
@@ -0,0 +1,296 @@
+#include "RenderQueue.h"
+#include <string.h>
+#include <cassert>
+
+void RenderFrame::Clear() {
+	commands.clear();
+	text.clear();
+	levelTiles.clear();
+	levelAnimations.clear();
+	tileChanges.clear();
+}
+
+RenderQueue::RenderQueue() {
+	program = nullptr;
+	recordIndex = 0;
+	batchProgram = nullptr;
+	instanceProgram = nullptr;
+	instanceTexture = 0;
+	spritesPending = false;
+	spriteBatch.stream = &streamBuffer;
+	instanceBatch.stream = &streamBuffer;
+}
+
+void RenderQueue::Begin(ShaderProgram *program, const Matrix &projectionMatrix, const Matrix &viewMatrix) {
+	this->program = program;
+	frames[recordIndex].projectionMatrix = projectionMatrix;
+	frames[recordIndex].viewMatrix = viewMatrix;
+}
+
+static uint32_t depthBits(float depth) {
+	// flip the float bits so unsigned integer order matches float order
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// GL names are not bounded by the key's fields, so each name gets the next index the first
+// time it is submitted. Name 0 keeps slot 0, so flat quads still sort under textured ones.
+static uint32_t keySlot(std::vector<GLuint> &slots, GLuint name, size_t slotCount) {
+	if (name == 0) {
+		return 0;
+	}
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slots[i] == name) {
+			return (uint32_t)(i + 1);
+		}
+	}
+	slots.push_back(name);
+	assert(slots.size() < slotCount);
+	return (uint32_t)slots.size();
+}
+
+RenderCommand &RenderQueue::Submit(RenderCommandType type, RenderLayer layer, ShaderProgram *program, GLuint textureID, float depth) {
+	RenderCommand command;
+	command.type = type;
+	command.program = program;
+	command.textureID = textureID;
+	command.tileMesh = nullptr;
+	command.shaderTileMap = nullptr;
+	command.textID = 0;
+	command.textOffset = 0;
+	command.textLength = 0;
+	for (int i = 0; i < 4; i++) {
+		command.color[i] = 1.0f;
+	}
+	GLuint programID = program != nullptr ? program->programID : 0;
+	uint64_t programSlot = keySlot(programSlots, programID, 0x100);
+	uint64_t textureSlot = keySlot(textureSlots, textureID, 0x10000);
+	command.key = ((uint64_t)(layer & 0xFF) << 56) | (programSlot << 48) | (textureSlot << 32) | depthBits(depth);
+	frames[recordIndex].commands.push_back(command);
+	return frames[recordIndex].commands.back();
+}
+
+void RenderQueue::SubmitSprite(RenderLayer layer, GLuint textureID, float depth, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight) {
+	RenderCommand &command = Submit(COMMAND_SPRITE, layer, program, textureID, depth);
+	command.rect[0] = x;
+	command.rect[1] = y;
+	command.rect[2] = width;
+	command.rect[3] = height;
+	command.texRect[0] = u;
+	command.texRect[1] = v;
+	command.texRect[2] = uWidth;
+	command.texRect[3] = vHeight;
+}
+
+// Flat coloured quad. Texture 0 sorts it under the textured sprites of its layer, and with the
+// sprite shader it lands in the same batch as them.
+void RenderQueue::SubmitRect(RenderLayer layer, float depth, float x, float y, float width, float height, float r, float g, float b, float a) {
+	SubmitSprite(layer, 0, depth, x, y, width, height, 0.0f, 0.0f, 0.0f, 0.0f);
+	float *color = frames[recordIndex].commands.back().color;
+	color[0] = r;
+	color[1] = g;
+	color[2] = b;
+	color[3] = a;
+}
+
+void RenderQueue::SubmitInstance(RenderLayer layer, GLuint textureID, float depth, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight) {
+	SubmitSprite(layer, textureID, depth, x, y, width, height, u, v, uWidth, vHeight);
+	frames[recordIndex].commands.back().type = COMMAND_INSTANCE;
+}
+
+void RenderQueue::SubmitTiles(RenderLayer layer, GLuint textureID, TileMesh *tileMesh, float viewLeft, float viewRight, float viewBottom, float viewTop) {
+	RenderCommand &command = Submit(COMMAND_TILES, layer, program, textureID, 0.0f);
+	command.tileMesh = tileMesh;
+	command.rect[0] = viewLeft;
+	command.rect[1] = viewRight;
+	command.rect[2] = viewBottom;
+	command.rect[3] = viewTop;
+}
+
+void RenderQueue::SubmitShaderTiles(RenderLayer layer, GLuint textureID, ShaderTileMap *shaderTileMap, float viewLeft, float viewRight, float viewBottom, float viewTop) {
+	RenderCommand &command = Submit(COMMAND_SHADER_TILES, layer, shaderTileMap->program, textureID, 0.0f);
+	command.shaderTileMap = shaderTileMap;
+	command.rect[0] = viewLeft;
+	command.rect[1] = viewRight;
+	command.rect[2] = viewBottom;
+	command.rect[3] = viewTop;
+}
+
+// Each distinct string is interned for the life of the queue, so the text cache can key on
+// its id; meant for the fixed strings of menus and labels, not ones that change every frame.
+void RenderQueue::SubmitText(RenderLayer layer, GLuint textureID, const AtlasRegion &fontRegion, const std::string &text, float size, float spacing, float x, float y) {
+	RenderCommand &command = Submit(COMMAND_TEXT, layer, program, textureID, 0.0f);
+	auto found = textIDs.find(text);
+	if (found == textIDs.end()) {
+		found = textIDs.insert(std::make_pair(text, (uint32_t)textIDs.size())).first;
+	}
+	command.textID = found->second;
+	std::string &frameText = frames[recordIndex].text;
+	command.textOffset = (uint32_t)frameText.size();
+	command.textLength = (uint32_t)text.size();
+	frameText.append(text);
+	command.rect[0] = x;
+	command.rect[1] = y;
+	command.rect[2] = size;
+	command.rect[3] = spacing;
+	command.texRect[0] = fontRegion.u;
+	command.texRect[1] = fontRegion.v;
+	command.texRect[2] = fontRegion.width;
+	command.texRect[3] = fontRegion.height;
+}
+
+// Drives tile animations; it only has to keep increasing while the game runs.
+void RenderQueue::SetTime(float time) {
+	frames[recordIndex].time = time;
+}
+
+void RenderQueue::SubmitLevel(int **mapData, int mapWidth, int mapHeight, const std::vector<FlareMapAnimation> &animations) {
+	RenderFrame &frame = frames[recordIndex];
+	frame.levelAnimations = animations;
+	frame.levelTiles.resize(mapWidth * mapHeight);
+	for (int y = 0; y < mapHeight; y++) {
+		std::copy(mapData[y], mapData[y] + mapWidth, frame.levelTiles.begin() + y * mapWidth);
+	}
+	frame.levelWidth = mapWidth;
+	frame.levelHeight = mapHeight;
+	// earlier changes are already part of the copied map
+	frame.tileChanges.clear();
+}
+
+void RenderQueue::SubmitTileChange(int gridX, int gridY, int value) {
+	TileChange change = { gridX, gridY, value };
+	frames[recordIndex].tileChanges.push_back(change);
+}
+
+RenderFrame *RenderQueue::EndFrame() {
+	RenderFrame *frame = &frames[recordIndex];
+	recordIndex = 1 - recordIndex;
+	frames[recordIndex].Clear();
+	return frame;
+}
+
+void RenderQueue::SortCommands(const std::vector<RenderCommand> &commands) {
+	size_t count = commands.size();
+	order.resize(count);
+	sortScratch.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		order[i] = (uint32_t)i;
+	}
+	// LSD radix sort on 8-bit digits; stable, so equal keys stay in submission order
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t histogram[257] = { 0 };
+		for (size_t i = 0; i < count; i++) {
+			histogram[((commands[order[i]].key >> shift) & 0xFF) + 1]++;
+		}
+		if (histogram[((commands[order[0]].key >> shift) & 0xFF) + 1] == count) {
+			continue;
+		}
+		for (int digit = 0; digit < 256; digit++) {
+			histogram[digit + 1] += histogram[digit];
+		}
+		for (size_t i = 0; i < count; i++) {
+			sortScratch[histogram[(commands[order[i]].key >> shift) & 0xFF]++] = order[i];
+		}
+		order.swap(sortScratch);
+	}
+}
+
+void RenderQueue::FlushSprites() {
+	if (spritesPending) {
+		spriteBatch.End();
+		spritesPending = false;
+	}
+}
+
+void RenderQueue::FlushInstances() {
+	if (instanceProgram != nullptr) {
+		instanceBatch.Draw(instanceProgram, instanceTexture);
+		instanceProgram = nullptr;
+	}
+}
+
+void RenderQueue::Execute(RenderFrame &frame) {
+	glClear(GL_COLOR_BUFFER_BIT);
+	const std::vector<RenderCommand> &commands = frame.commands;
+	if (commands.empty()) {
+		return;
+	}
+	textCache.BeginFrame();
+	streamBuffer.BeginFrame();
+	SortCommands(commands);
+	ShaderProgram *framedProgram = nullptr;
+	for (size_t i = 0; i < order.size(); i++) {
+		const RenderCommand &command = commands[order[i]];
+		if (command.program != framedProgram) {
+			// uniform caching makes this a no-op for programs that already have the matrices
+			command.program->SetFrameMatrices(frame.projectionMatrix, frame.viewMatrix);
+			framedProgram = command.program;
+		}
+		switch (command.type) {
+		case COMMAND_SPRITE:
+			FlushInstances();
+			if (!spritesPending || batchProgram != command.program) {
+				FlushSprites();
+				spriteBatch.Begin(command.program);
+				batchProgram = command.program;
+				spritesPending = true;
+			}
+			spriteBatch.DrawQuad(command.textureID, command.rect[0], command.rect[1], command.rect[2], command.rect[3],
+				command.texRect[0], command.texRect[1], command.texRect[2], command.texRect[3], command.color);
+			break;
+		case COMMAND_INSTANCE:
+			FlushSprites();
+			if (instanceProgram != command.program || instanceTexture != command.textureID) {
+				FlushInstances();
+				instanceProgram = command.program;
+				instanceTexture = command.textureID;
+			}
+			instanceBatch.Add(command.rect[0], command.rect[1], command.rect[2], command.rect[3],
+				command.texRect[0], command.texRect[1], command.texRect[2], command.texRect[3]);
+			break;
+		case COMMAND_TILES: {
+			FlushSprites();
+			FlushInstances();
+			Matrix modelMatrix;
+			command.program->Use();
+			ShaderProgram::BindTexture(command.textureID);
+			command.program->SetModelMatrix(modelMatrix);
+			tileAnimations.Apply(command.program, frame.time);
+			command.tileMesh->Draw(command.program, command.rect[0], command.rect[1], command.rect[2], command.rect[3]);
+			break;
+		}
+		case COMMAND_SHADER_TILES: {
+			FlushSprites();
+			FlushInstances();
+			Matrix modelMatrix;
+			ShaderProgram::BindTexture(command.textureID);
+			command.program->SetModelMatrix(modelMatrix);
+			tileAnimations.Apply(command.program, frame.time);
+			command.shaderTileMap->Draw(&streamBuffer, command.rect[0], command.rect[1], command.rect[2], command.rect[3]);
+			break;
+		}
+		case COMMAND_TEXT: {
+			FlushSprites();
+			FlushInstances();
+			AtlasRegion fontRegion(command.texRect[0], command.texRect[1], command.texRect[2], command.texRect[3]);
+			TextRun *textRun = textCache.Get(fontRegion, command.textID, frame.text.data() + command.textOffset, command.textLength, command.rect[2], command.rect[3]);
+			command.program->Use();
+			ShaderProgram::BindTexture(command.textureID);
+			textRun->Draw(command.program, command.rect[0], command.rect[1]);
+			break;
+		}
+		}
+	}
+	FlushSprites();
+	FlushInstances();
+	streamBuffer.EndFrame();
+}
+
+void RenderQueue::Cleanup() {
+	spriteBatch.Cleanup();
+	instanceBatch.Cleanup();
+	textCache.Cleanup();
+	tileAnimations.Cleanup();
+	streamBuffer.Cleanup();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Matrix.h"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "InstanceBatch.h"
+#include "TileMesh.h"
+#include "TextCache.h"
+#include "ShaderTileMap.h"
+#include "StreamBuffer.h"
+#include "TileAnimation.h"
+
+enum RenderLayer { LAYER_TILES, LAYER_WORLD, LAYER_HUD };
+
+enum RenderCommandType { COMMAND_SPRITE, COMMAND_INSTANCE, COMMAND_TILES, COMMAND_SHADER_TILES, COMMAND_TEXT };
+
+// Sort key, most significant first: layer (8 bits), program slot (8), texture slot (16),
+// depth (32). Slots are small indices the queue hands out per GL name.
+struct RenderCommand {
+	uint64_t key;
+	RenderCommandType type;
+	ShaderProgram *program;
+	GLuint textureID;
+	TileMesh *tileMesh;
+	ShaderTileMap *shaderTileMap;
+	uint32_t textID;
+	uint32_t textOffset;
+	uint32_t textLength;
+	float rect[4];
+	float texRect[4];
+	float color[4];
+};
+
+struct TileChange {
+	int gridX;
+	int gridY;
+	int value;
+};
+
+// Everything the GL side needs to draw one frame. Once handed to Execute it is not
+// touched by the simulation, which records the next frame into the other buffer.
+struct RenderFrame {
+	void Clear();
+
+	Matrix projectionMatrix;
+	Matrix viewMatrix;
+	float time;
+	std::vector<RenderCommand> commands;
+	std::string text;
+	std::vector<int> levelTiles;
+	int levelWidth;
+	int levelHeight;
+	std::vector<FlareMapAnimation> levelAnimations;
+	std::vector<TileChange> tileChanges;
+};
+
+// Draw functions submit commands during render() and the queue radix sorts them by key
+// and executes them at the end of the frame, so commands sharing a program and texture
+// end up adjacent and merge into the same batch. Equal keys keep submission order.
+// Submitting never calls GL, so recording can run on a different thread than Execute.
+class RenderQueue {
+	public:
+		RenderQueue();
+
+		void Begin(ShaderProgram *program, const Matrix &projectionMatrix, const Matrix &viewMatrix);
+		void SubmitSprite(RenderLayer layer, GLuint textureID, float depth, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight);
+		void SubmitRect(RenderLayer layer, float depth, float x, float y, float width, float height, float r, float g, float b, float a);
+		void SubmitInstance(RenderLayer layer, GLuint textureID, float depth, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight);
+		void SubmitTiles(RenderLayer layer, GLuint textureID, TileMesh *tileMesh, float viewLeft, float viewRight, float viewBottom, float viewTop);
+		void SubmitShaderTiles(RenderLayer layer, GLuint textureID, ShaderTileMap *shaderTileMap, float viewLeft, float viewRight, float viewBottom, float viewTop);
+		void SubmitText(RenderLayer layer, GLuint textureID, const AtlasRegion &fontRegion, const std::string &text, float size, float spacing, float x, float y);
+		void SetTime(float time);
+		void SubmitLevel(int **mapData, int mapWidth, int mapHeight, const std::vector<FlareMapAnimation> &animations);
+		void SubmitTileChange(int gridX, int gridY, int value);
+
+		RenderFrame *EndFrame();
+		void Execute(RenderFrame &frame);
+		void Cleanup();
+
+		StreamBuffer streamBuffer;
+		SpriteBatch spriteBatch;
+		InstanceBatch instanceBatch;
+		TextCache textCache;
+		TileAnimationTable tileAnimations;
+
+	private:
+		RenderCommand &Submit(RenderCommandType type, RenderLayer layer, ShaderProgram *program, GLuint textureID, float depth);
+		void SortCommands(const std::vector<RenderCommand> &commands);
+		void FlushSprites();
+		void FlushInstances();
+
+		ShaderProgram *program;
+		RenderFrame frames[2];
+		int recordIndex;
+		std::vector<uint32_t> order;
+		std::vector<uint32_t> sortScratch;
+		std::vector<GLuint> programSlots;
+		std::vector<GLuint> textureSlots;
+		std::unordered_map<std::string, uint32_t> textIDs;
+
+		ShaderProgram *batchProgram;
+		ShaderProgram *instanceProgram;
+		GLuint instanceTexture;
+		bool spritesPending;
+};
@@ -0,0 +1,92 @@
+#include "RenderThread.h"
+
+RenderThread::RenderThread() {
+	thread = nullptr;
+	mutex = nullptr;
+	frameReady = nullptr;
+	frameDone = nullptr;
+	pending = nullptr;
+	busy = false;
+	quit = false;
+	window = nullptr;
+	context = nullptr;
+	drawFrame = nullptr;
+}
+
+void RenderThread::Start(SDL_Window *window, SDL_GLContext context, DrawFrameFunction drawFrame) {
+	this->window = window;
+	this->context = context;
+	this->drawFrame = drawFrame;
+	mutex = SDL_CreateMutex();
+	frameReady = SDL_CreateCond();
+	frameDone = SDL_CreateCond();
+	pending = nullptr;
+	busy = false;
+	quit = false;
+	// a context can only be current on one thread, so release it here first
+	SDL_GL_MakeCurrent(window, nullptr);
+	thread = SDL_CreateThread(Run, "Render", this);
+}
+
+int RenderThread::Run(void *data) {
+	((RenderThread*)data)->Loop();
+	return 0;
+}
+
+void RenderThread::Loop() {
+	SDL_GL_MakeCurrent(window, context);
+	SDL_LockMutex(mutex);
+	while (true) {
+		while (pending == nullptr && !quit) {
+			SDL_CondWait(frameReady, mutex);
+		}
+		if (pending == nullptr) {
+			break;
+		}
+		RenderFrame *frame = pending;
+		pending = nullptr;
+		busy = true;
+		SDL_UnlockMutex(mutex);
+
+		drawFrame(*frame);
+		SDL_GL_SwapWindow(window);
+
+		SDL_LockMutex(mutex);
+		busy = false;
+		SDL_CondBroadcast(frameDone);
+	}
+	SDL_UnlockMutex(mutex);
+	SDL_GL_MakeCurrent(window, nullptr);
+}
+
+void RenderThread::WaitIdle() {
+	SDL_LockMutex(mutex);
+	while (pending != nullptr || busy) {
+		SDL_CondWait(frameDone, mutex);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+void RenderThread::Submit(RenderFrame *frame) {
+	SDL_LockMutex(mutex);
+	pending = frame;
+	SDL_CondSignal(frameReady);
+	SDL_UnlockMutex(mutex);
+}
+
+void RenderThread::Stop() {
+	if (thread == nullptr) {
+		return;
+	}
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondSignal(frameReady);
+	SDL_UnlockMutex(mutex);
+	SDL_WaitThread(thread, nullptr);
+	thread = nullptr;
+	SDL_DestroyCond(frameReady);
+	SDL_DestroyCond(frameDone);
+	SDL_DestroyMutex(mutex);
+	// hand the context back to the calling thread for shutdown
+	SDL_GL_MakeCurrent(window, context);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SDL.h>
+#include "RenderQueue.h"
+
+typedef void (*DrawFrameFunction)(RenderFrame &frame);
+
+// Owns the GL context on a thread of its own. The simulation records a RenderFrame,
+// hands it over with Submit and goes on to update the next frame while this thread
+// draws and swaps the previous one. At most one frame is in flight, so together with
+// the queue's two frame buffers nothing is shared between the threads mid-frame.
+class RenderThread {
+	public:
+		RenderThread();
+
+		void Start(SDL_Window *window, SDL_GLContext context, DrawFrameFunction drawFrame);
+		void WaitIdle();
+		void Submit(RenderFrame *frame);
+		void Stop();
+
+	private:
+		static int Run(void *data);
+		void Loop();
+
+		SDL_Thread *thread;
+		SDL_mutex *mutex;
+		SDL_cond *frameReady;
+		SDL_cond *frameDone;
+		RenderFrame *pending;
+		bool busy;
+		bool quit;
+
+		SDL_Window *window;
+		SDL_GLContext context;
+		DrawFrameFunction drawFrame;
+};
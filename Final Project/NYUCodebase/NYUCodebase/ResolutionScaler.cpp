@@ -0,0 +1,143 @@
+#include "ResolutionScaler.h"
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+
+static bool versionAtLeast(int wantMajor, int wantMinor) {
+	int major = 0;
+	int minor = 0;
+	const char *version = (const char*)glGetString(GL_VERSION);
+	if (version != NULL) {
+		sscanf(version, "%d.%d", &major, &minor);
+	}
+	return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+ResolutionScaler::ResolutionScaler() {
+	width = 0;
+	height = 0;
+	scale = 1.0f;
+	frameBudget = 14.0f;
+	averageFrameTime = 0.0f;
+	framebuffer = 0;
+	colorBuffer = 0;
+	renderWidth = 0;
+	renderHeight = 0;
+	settleFrames = 0;
+	for (int i = 0; i < RESOLUTION_QUERY_COUNT; i++) {
+		queries[i] = 0;
+		queryPending[i] = false;
+	}
+	query = 0;
+	measuring = false;
+}
+
+bool ResolutionScaler::Create(int width, int height) {
+	if (!versionAtLeast(3, 3) && !SDL_GL_ExtensionSupported("GL_ARB_timer_query")) {
+		std::cerr << "Dynamic resolution needs timer queries (GL 3.3 / ARB_timer_query)" << std::endl;
+		return false;
+	}
+	this->width = width;
+	this->height = height;
+	renderWidth = width;
+	renderHeight = height;
+	// allocated once at full size; scaling only changes how much of it is used
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glGenQueries(RESOLUTION_QUERY_COUNT, queries);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Scaled framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		Cleanup();
+		return false;
+	}
+	return true;
+}
+
+void ResolutionScaler::Begin() {
+	ReadQueries();
+	// a slot whose result is still in flight is skipped rather than waited on
+	measuring = !queryPending[query];
+	if (measuring) {
+		glBeginQuery(GL_TIME_ELAPSED, queries[query]);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, renderWidth, renderHeight);
+}
+
+void ResolutionScaler::End() {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	if (measuring) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryPending[query] = true;
+	}
+	query = (query + 1) % RESOLUTION_QUERY_COUNT;
+}
+
+// feeds every finished query to Adjust, oldest first
+void ResolutionScaler::ReadQueries() {
+	for (int i = 0; i < RESOLUTION_QUERY_COUNT; i++) {
+		int slot = (query + i) % RESOLUTION_QUERY_COUNT;
+		if (!queryPending[slot]) {
+			continue;
+		}
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			continue;
+		}
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+		queryPending[slot] = false;
+		Adjust((float)((double)nanoseconds / 1000000.0));
+	}
+}
+
+void ResolutionScaler::Adjust(float frameTime) {
+	averageFrameTime = averageFrameTime > 0.0f ? averageFrameTime * 0.9f + frameTime * 0.1f : frameTime;
+	if (settleFrames > 0) {
+		settleFrames--;
+		return;
+	}
+	float previousScale = scale;
+	if (averageFrameTime > frameBudget && scale > RESOLUTION_MIN_SCALE) {
+		scale = std::max(scale - RESOLUTION_SCALE_STEP, RESOLUTION_MIN_SCALE);
+	}
+	else if (averageFrameTime < frameBudget * 0.7f && scale < 1.0f) {
+		scale = std::min(scale + RESOLUTION_SCALE_STEP, 1.0f);
+	}
+	if (scale != previousScale) {
+		renderWidth = (int)(width * scale);
+		renderHeight = (int)(height * scale);
+		// let the average catch up with the new size before judging it
+		settleFrames = RESOLUTION_SETTLE_FRAMES;
+	}
+}
+
+void ResolutionScaler::Cleanup() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+	if (colorBuffer != 0) {
+		glDeleteRenderbuffers(1, &colorBuffer);
+		colorBuffer = 0;
+	}
+	if (queries[0] != 0) {
+		glDeleteQueries(RESOLUTION_QUERY_COUNT, queries);
+		for (int i = 0; i < RESOLUTION_QUERY_COUNT; i++) {
+			queries[i] = 0;
+			queryPending[i] = false;
+		}
+	}
+}
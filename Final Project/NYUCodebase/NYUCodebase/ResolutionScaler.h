@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <SDL.h>
+
+#define RESOLUTION_MIN_SCALE 0.5f
+#define RESOLUTION_SCALE_STEP 0.1f
+#define RESOLUTION_SETTLE_FRAMES 30
+#define RESOLUTION_QUERY_COUNT 3
+
+// Renders the scene into the corner of a window sized framebuffer and stretches it over
+// the window with nearest filtering. The used corner shrinks while the GPU time of a frame
+// stays over frameBudget and grows back once there is comfortable headroom again. GPU time
+// comes from GL_TIME_ELAPSED queries read back a frame or two later, so measuring never
+// waits on the GPU.
+class ResolutionScaler {
+	public:
+		ResolutionScaler();
+
+		bool Create(int width, int height);
+		void Begin();
+		void End();
+		void Cleanup();
+
+		int width;
+		int height;
+		float scale;
+		float frameBudget;
+		float averageFrameTime;
+
+	private:
+		void Adjust(float frameTime);
+		void ReadQueries();
+
+		GLuint framebuffer;
+		GLuint colorBuffer;
+		int renderWidth;
+		int renderHeight;
+		int settleFrames;
+		GLuint queries[RESOLUTION_QUERY_COUNT];
+		bool queryPending[RESOLUTION_QUERY_COUNT];
+		int query;
+		bool measuring;
+};
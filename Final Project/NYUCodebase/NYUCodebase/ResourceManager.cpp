@@ -0,0 +1,143 @@
+#include "ResourceManager.h"
+#include <cassert>
+
+TextureOptions::TextureOptions() {
+	nearest = true;
+	mipmaps = false;
+}
+
+TextureOptions::TextureOptions(bool nearest, bool mipmaps) {
+	this->nearest = nearest;
+	this->mipmaps = mipmaps;
+}
+
+ResourceManager::ResourceManager() {
+	textureBudget = 0;
+	textureMemory = 0;
+}
+
+GLuint ResourceManager::CreateTexture(const std::string &name, const unsigned char *pixels, int width, int height, const TextureOptions &options) {
+	auto found = textureNames.find(name);
+	if (found != textureNames.end()) {
+		RetainTexture(found->second);
+		return found->second;
+	}
+
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	ShaderProgram::BindTexture(textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	GLint minFilter = options.nearest ? GL_NEAREST : GL_LINEAR;
+	if (options.mipmaps) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+		minFilter = options.nearest ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_LINEAR;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.nearest ? GL_NEAREST : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	ManagedTexture texture;
+	texture.name = name;
+	texture.width = width;
+	texture.height = height;
+	texture.mipmaps = options.mipmaps;
+	// a full mip chain adds a third on top of the base level
+	texture.bytes = (size_t)width * height * 4;
+	if (options.mipmaps) {
+		texture.bytes += texture.bytes / 3;
+	}
+	texture.references = 1;
+	textures[textureID] = texture;
+	textureNames[name] = textureID;
+	textureMemory += texture.bytes;
+	if (textureBudget > 0 && textureMemory > textureBudget) {
+		std::cout << "Texture memory " << textureMemory / 1024 << " KB is over the " << textureBudget / 1024 << " KB budget after loading " << name << "\n";
+	}
+	return textureID;
+}
+
+void ResourceManager::RetainTexture(GLuint textureID) {
+	auto found = textures.find(textureID);
+	if (found != textures.end()) {
+		found->second.references++;
+	}
+}
+
+void ResourceManager::ReleaseTexture(GLuint textureID) {
+	auto found = textures.find(textureID);
+	if (found == textures.end()) {
+		return;
+	}
+	if (--found->second.references > 0) {
+		return;
+	}
+	// deleting a bound texture unbinds it, keep the bind cache in step
+	ShaderProgram::BindTexture(0);
+	glDeleteTextures(1, &textureID);
+	textureMemory -= found->second.bytes;
+	textureNames.erase(found->second.name);
+	textures.erase(found);
+}
+
+ShaderProgram *ResourceManager::LoadProgram(const std::string &vertexShaderFile, const std::string &fragmentShaderFile, const std::string &fragmentLibraryFile) {
+	std::string key = vertexShaderFile + "|" + fragmentShaderFile + "|" + fragmentLibraryFile;
+	auto found = programs.find(key);
+	if (found != programs.end()) {
+		found->second.references++;
+		return found->second.program;
+	}
+	ManagedProgram managed;
+	managed.program = new ShaderProgram();
+	managed.program->Load(vertexShaderFile.c_str(), fragmentShaderFile.c_str(), fragmentLibraryFile.empty() ? nullptr : fragmentLibraryFile.c_str());
+	managed.references = 1;
+	programs[key] = managed;
+	return managed.program;
+}
+
+void ResourceManager::ReleaseProgram(ShaderProgram *program) {
+	for (auto it = programs.begin(); it != programs.end(); ++it) {
+		if (it->second.program != program) {
+			continue;
+		}
+		if (--it->second.references == 0) {
+			program->Cleanup();
+			delete program;
+			programs.erase(it);
+		}
+		return;
+	}
+}
+
+size_t ResourceManager::GetTextureMemory() const {
+	return textureMemory;
+}
+
+void ResourceManager::PrintReport(std::ostream &out) const {
+	for (auto it = textures.begin(); it != textures.end(); ++it) {
+		const ManagedTexture &texture = it->second;
+		out << texture.name << ": " << texture.width << "x" << texture.height << (texture.mipmaps ? " mipmapped" : "")
+			<< ", " << texture.bytes / 1024 << " KB, " << texture.references << " references\n";
+	}
+	out << "Texture memory: " << textureMemory / 1024 << " KB";
+	if (textureBudget > 0) {
+		out << " of " << textureBudget / 1024 << " KB budget";
+	}
+	out << ", " << programs.size() << " shader programs\n";
+}
+
+void ResourceManager::Cleanup() {
+	for (auto it = textures.begin(); it != textures.end(); ++it) {
+		GLuint textureID = it->first;
+		glDeleteTextures(1, &textureID);
+	}
+	ShaderProgram::BindTexture(0);
+	textures.clear();
+	textureNames.clear();
+	textureMemory = 0;
+	for (auto it = programs.begin(); it != programs.end(); ++it) {
+		it->second.program->Cleanup();
+		delete it->second.program;
+	}
+	programs.clear();
+}
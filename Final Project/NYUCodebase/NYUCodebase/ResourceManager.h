@@ -0,0 +1,63 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include "ShaderProgram.h"
+
+// Sampling setup for a managed texture. Pixel art sheets want nearest filtering, and
+// mipmaps only help where sprites are drawn smaller than their source size.
+struct TextureOptions {
+	TextureOptions();
+	TextureOptions(bool nearest, bool mipmaps);
+
+	bool nearest;
+	bool mipmaps;
+};
+
+// Owns every texture and shader program. Textures are keyed by a caller chosen name and
+// programs by their shader paths, so creating the same one twice shares it, and each
+// create must be balanced by a Release; the GL object is deleted when its last reference
+// goes. Texture memory is tracked so it can be checked against textureBudget (bytes, 0 for
+// none).
+class ResourceManager {
+	public:
+		ResourceManager();
+
+		GLuint CreateTexture(const std::string &name, const unsigned char *pixels, int width, int height, const TextureOptions &options);
+		void RetainTexture(GLuint textureID);
+		void ReleaseTexture(GLuint textureID);
+
+		ShaderProgram *LoadProgram(const std::string &vertexShaderFile, const std::string &fragmentShaderFile, const std::string &fragmentLibraryFile = "");
+		void ReleaseProgram(ShaderProgram *program);
+
+		size_t GetTextureMemory() const;
+		void PrintReport(std::ostream &out) const;
+		void Cleanup();
+
+		size_t textureBudget;
+
+	private:
+		struct ManagedTexture {
+			std::string name;
+			int width;
+			int height;
+			bool mipmaps;
+			size_t bytes;
+			int references;
+		};
+
+		struct ManagedProgram {
+			ShaderProgram *program;
+			int references;
+		};
+
+		std::map<std::string, GLuint> textureNames;
+		std::map<GLuint, ManagedTexture> textures;
+		std::map<std::string, ManagedProgram> programs;
+		size_t textureMemory;
+};
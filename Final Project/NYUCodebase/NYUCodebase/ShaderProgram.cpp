@@ -1,7 +1,52 @@
 
 #include "ShaderProgram.h"
+#include <string.h>
 
-void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile) {
+GLStateStats ShaderProgram::stats;
+GLuint ShaderProgram::currentProgram = 0;
+GLuint ShaderProgram::currentTexture = 0;
+
+GLStateStats::GLStateStats() {
+    Reset();
+}
+
+void GLStateStats::Reset() {
+    programBinds = 0;
+    programBindsSkipped = 0;
+    textureBinds = 0;
+    textureBindsSkipped = 0;
+    uniformUploads = 0;
+    uniformUploadsSkipped = 0;
+}
+
+void GLStateStats::Add(const GLStateStats &other) {
+    programBinds += other.programBinds;
+    programBindsSkipped += other.programBindsSkipped;
+    textureBinds += other.textureBinds;
+    textureBindsSkipped += other.textureBindsSkipped;
+    uniformUploads += other.uniformUploads;
+    uniformUploadsSkipped += other.uniformUploadsSkipped;
+}
+
+ShaderProgram::ShaderProgram() {
+    programID = 0;
+    fragmentLibraryShader = 0;
+    instanceRectAttribute = -1;
+    instanceTexRectAttribute = -1;
+    texCellAttribute = -1;
+    tintAttribute = -1;
+    texturedAttribute = -1;
+    tileAttribute = -1;
+    modelMatrixValid = false;
+    projectionMatrixValid = false;
+    viewMatrixValid = false;
+    colorValid = false;
+    animationTimeValid = false;
+}
+
+// A fragment library is a second fragment shader object linked into the program, for
+// functions several shaders share; they declare what they call from it.
+void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile, const char *fragmentLibraryFile) {
     
     // create the vertex shader
     vertexShader = LoadShaderFromFile(vertexShaderFile, GL_VERTEX_SHADER);
@@ -12,6 +57,12 @@ void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShade
     programID = glCreateProgram();
     glAttachShader(programID, vertexShader);
     glAttachShader(programID, fragmentShader);
+    if (fragmentLibraryFile != nullptr) {
+        fragmentLibraryShader = LoadShaderFromFile(fragmentLibraryFile, GL_FRAGMENT_SHADER);
+        glAttachShader(programID, fragmentLibraryShader);
+    }
+    // keep position on attribute 0, which compatibility contexts require to be an enabled array
+    glBindAttribLocation(programID, 0, "position");
     glLinkProgram(programID);
     
     GLint linkSuccess;
@@ -24,18 +75,44 @@ void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShade
     projectionMatrixUniform = glGetUniformLocation(programID, "projectionMatrix");
     viewMatrixUniform = glGetUniformLocation(programID, "viewMatrix");
 	colorUniform = glGetUniformLocation(programID, "color");
+    // only the tile shaders read the animation table
+    animationTableUniform = glGetUniformLocation(programID, "animationTable");
+    animationTableSizeUniform = glGetUniformLocation(programID, "animationTableSize");
+    animationColumnsUniform = glGetUniformLocation(programID, "animationColumns");
+    animationTimeUniform = glGetUniformLocation(programID, "animationTime");
     
     positionAttribute = glGetAttribLocation(programID, "position");
     texCoordAttribute = glGetAttribLocation(programID, "texCoord");
+    instanceRectAttribute = glGetAttribLocation(programID, "instanceRect");
+    instanceTexRectAttribute = glGetAttribLocation(programID, "instanceTexRect");
+    texCellAttribute = glGetAttribLocation(programID, "texCell");
+    // only the sprite shader has these; older shader pairs simply report -1
+    tintAttribute = glGetAttribLocation(programID, "tint");
+    texturedAttribute = glGetAttribLocation(programID, "textured");
+    tileAttribute = glGetAttribLocation(programID, "tile");
+    ResetInstanceAttributes();
+
+    modelMatrixValid = false;
+    projectionMatrixValid = false;
+    viewMatrixValid = false;
+    colorValid = false;
+    animationTimeValid = false;
 	
 	SetColor(1.0f, 1.0f, 1.0f, 1.0f);
     
 }
 
 void ShaderProgram::Cleanup() {
+    if (currentProgram == programID) {
+        glUseProgram(0);
+        currentProgram = 0;
+    }
     glDeleteProgram(programID);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    if (fragmentLibraryShader != 0) {
+        glDeleteShader(fragmentLibraryShader);
+    }
 }
 
 GLuint ShaderProgram::LoadShaderFromFile(const std::string &shaderFile, GLenum type) {
@@ -83,22 +160,105 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
     return shaderID;
 }
 
+void ShaderProgram::Use() {
+    if (currentProgram == programID) {
+        stats.programBindsSkipped++;
+        return;
+    }
+    glUseProgram(programID);
+    currentProgram = programID;
+    stats.programBinds++;
+}
+
+void ShaderProgram::BindTexture(GLuint textureID) {
+    if (currentTexture == textureID) {
+        stats.textureBindsSkipped++;
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    currentTexture = textureID;
+    stats.textureBinds++;
+}
+
+bool ShaderProgram::UploadMatrix(GLuint uniform, const Matrix &matrix, float *cached, bool &valid) {
+    if (valid && memcmp(cached, matrix.ml, sizeof(matrix.ml)) == 0) {
+        stats.uniformUploadsSkipped++;
+        return false;
+    }
+    Use();
+    glUniformMatrix4fv(uniform, 1, GL_FALSE, matrix.ml);
+    memcpy(cached, matrix.ml, sizeof(matrix.ml));
+    valid = true;
+    stats.uniformUploads++;
+    return true;
+}
+
 void ShaderProgram::SetColor(float r, float g, float b, float a) {
-	glUseProgram(programID);
-	glUniform4f(colorUniform, r, g, b, a);
+    float color[] = { r, g, b, a };
+    if (colorValid && memcmp(colorCache, color, sizeof(color)) == 0) {
+        stats.uniformUploadsSkipped++;
+        return;
+    }
+    Use();
+    glUniform4f(colorUniform, r, g, b, a);
+    memcpy(colorCache, color, sizeof(color));
+    colorValid = true;
+    stats.uniformUploads++;
+}
+
+void ShaderProgram::SetAnimationTime(float time) {
+    if (animationTimeValid && animationTimeCache == time) {
+        stats.uniformUploadsSkipped++;
+        return;
+    }
+    Use();
+    glUniform1f(animationTimeUniform, time);
+    animationTimeCache = time;
+    animationTimeValid = true;
+    stats.uniformUploads++;
+}
+
+// Outside instanced draws the per-instance attributes read their constant value,
+// which has to be the identity rectangle.
+void ShaderProgram::ResetInstanceAttributes() {
+    if (instanceRectAttribute >= 0) {
+        glVertexAttrib4f(instanceRectAttribute, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+    if (instanceTexRectAttribute >= 0) {
+        glVertexAttrib4f(instanceTexRectAttribute, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+    // a zero sized cell turns texture wrapping off
+    if (texCellAttribute >= 0) {
+        glVertexAttrib4f(texCellAttribute, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    // untinted and textured, so meshes without these attributes draw as before
+    if (tintAttribute >= 0) {
+        glVertexAttrib4f(tintAttribute, 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    if (texturedAttribute >= 0) {
+        glVertexAttrib1f(texturedAttribute, 1.0f);
+    }
+    // tile 0 never animates
+    if (tileAttribute >= 0) {
+        glVertexAttrib1f(tileAttribute, 0.0f);
+    }
+}
+
+// Projection and view only change once per frame, so callers set them here at the
+// start of the frame and individual draws only touch the model matrix.
+void ShaderProgram::SetFrameMatrices(const Matrix &projection, const Matrix &view) {
+    SetProjectionMatrix(projection);
+    SetViewMatrix(view);
 }
 
 void ShaderProgram::SetViewMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, matrix.ml);
+    UploadMatrix(viewMatrixUniform, matrix, viewMatrixCache, viewMatrixValid);
 }
 
 void ShaderProgram::SetModelMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, matrix.ml);
+    UploadMatrix(modelMatrixUniform, matrix, modelMatrixCache, modelMatrixValid);
 }
 
 void ShaderProgram::SetProjectionMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, matrix.ml);    
+    UploadMatrix(projectionMatrixUniform, matrix, projectionMatrixCache, projectionMatrixValid);
 }
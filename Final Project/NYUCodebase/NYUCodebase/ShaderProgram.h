@@ -10,16 +10,38 @@
 #include <sstream>
 #include "Matrix.h"
 
+// Counts of GL binds and uniform uploads issued and skipped by the state cache.
+struct GLStateStats {
+    GLStateStats();
+    void Reset();
+    void Add(const GLStateStats &other);
+
+    int programBinds;
+    int programBindsSkipped;
+    int textureBinds;
+    int textureBindsSkipped;
+    int uniformUploads;
+    int uniformUploadsSkipped;
+};
+
 class ShaderProgram {
     public:
-	void Load(const char *vertexShaderFile, const char *fragmentShaderFile);
+        ShaderProgram();
+
+	void Load(const char *vertexShaderFile, const char *fragmentShaderFile, const char *fragmentLibraryFile = nullptr);
 	void Cleanup();   
 
+        void Use();
+        static void BindTexture(GLuint textureID);
+
+        void SetFrameMatrices(const Matrix &projection, const Matrix &view);
         void SetModelMatrix(const Matrix &matrix);
         void SetProjectionMatrix(const Matrix &matrix);
         void SetViewMatrix(const Matrix &matrix);
 	
 		void SetColor(float r, float g, float b, float a);
+		void SetAnimationTime(float time);
+		void ResetInstanceAttributes();
 	
         GLuint LoadShaderFromString(const std::string &shaderContents, GLenum type);
         GLuint LoadShaderFromFile(const std::string &shaderFile, GLenum type);
@@ -30,10 +52,40 @@ class ShaderProgram {
         GLuint modelMatrixUniform;
         GLuint viewMatrixUniform;
 		GLuint colorUniform;
+        GLint animationTableUniform;
+        GLint animationTableSizeUniform;
+        GLint animationColumnsUniform;
+        GLint animationTimeUniform;
 	
         GLuint positionAttribute;
         GLuint texCoordAttribute;
+        GLint instanceRectAttribute;
+        GLint instanceTexRectAttribute;
+        GLint texCellAttribute;
+        GLint tintAttribute;
+        GLint texturedAttribute;
+        GLint tileAttribute;
     
         GLuint vertexShader;
         GLuint fragmentShader;
+        GLuint fragmentLibraryShader;
+
+        static GLStateStats stats;
+
+    private:
+        bool UploadMatrix(GLuint uniform, const Matrix &matrix, float *cached, bool &valid);
+
+        float modelMatrixCache[16];
+        float projectionMatrixCache[16];
+        float viewMatrixCache[16];
+        float colorCache[4];
+        float animationTimeCache;
+        bool modelMatrixValid;
+        bool projectionMatrixValid;
+        bool viewMatrixValid;
+        bool colorValid;
+        bool animationTimeValid;
+
+        static GLuint currentProgram;
+        static GLuint currentTexture;
 };
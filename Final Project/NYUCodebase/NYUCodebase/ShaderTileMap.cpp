@@ -0,0 +1,122 @@
+#include "ShaderTileMap.h"
+
+ShaderTileMap::ShaderTileMap() {
+	program = nullptr;
+	indexTexture = 0;
+	mapWidth = 0;
+	mapHeight = 0;
+	spriteCountX = 1;
+	spriteCountY = 1;
+	tileSize = 1.0f;
+	uniformsDirty = true;
+}
+
+void ShaderTileMap::Load(ShaderProgram *program) {
+	this->program = program;
+	mapSizeUniform = glGetUniformLocation(program->programID, "mapSize");
+	spriteCountUniform = glGetUniformLocation(program->programID, "spriteCount");
+	atlasRectUniform = glGetUniformLocation(program->programID, "atlasRect");
+	emptyTileUniform = glGetUniformLocation(program->programID, "emptyTile");
+	program->Use();
+	glUniform1i(glGetUniformLocation(program->programID, "tileIndices"), 1);
+}
+
+void ShaderTileMap::Build(const int *tiles, int mapWidth, int mapHeight, int spriteCountX, int spriteCountY, float tileSize) {
+	this->tiles.assign(tiles, tiles + mapWidth * mapHeight);
+	this->mapWidth = mapWidth;
+	this->mapHeight = mapHeight;
+	this->spriteCountX = spriteCountX;
+	this->spriteCountY = spriteCountY;
+	this->tileSize = tileSize;
+	dirtyTiles.clear();
+	uniformsDirty = true;
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (mapWidth > maxSize || mapHeight > maxSize) {
+		std::cerr << "Map of " << mapWidth << "x" << mapHeight << " tiles exceeds GL_MAX_TEXTURE_SIZE " << maxSize << std::endl;
+	}
+
+	std::vector<unsigned char> texels((size_t)mapWidth * mapHeight * 2);
+	for (int y = 0; y < mapHeight; y++) {
+		for (int x = 0; x < mapWidth; x++) {
+			int tile = tiles[y * mapWidth + x];
+			texels[(y * mapWidth + x) * 2] = tile & 0xFF;
+			texels[(y * mapWidth + x) * 2 + 1] = (tile >> 8) & 0xFF;
+		}
+	}
+	if (indexTexture == 0) {
+		glGenTextures(1, &indexTexture);
+	}
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, indexTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, mapWidth, mapHeight, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void ShaderTileMap::SetAtlasRegion(const AtlasRegion &region) {
+	atlasRegion = region;
+	uniformsDirty = true;
+}
+
+void ShaderTileMap::SetTile(int gridX, int gridY, int value) {
+	if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight) {
+		return;
+	}
+	tiles[gridY * mapWidth + gridX] = value;
+	dirtyTiles.push_back(gridY * mapWidth + gridX);
+}
+
+void ShaderTileMap::UploadTile(int gridX, int gridY) {
+	int tile = tiles[gridY * mapWidth + gridX];
+	unsigned char texel[] = { (unsigned char)(tile & 0xFF), (unsigned char)((tile >> 8) & 0xFF) };
+	glTexSubImage2D(GL_TEXTURE_2D, 0, gridX, gridY, 1, 1, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texel);
+}
+
+void ShaderTileMap::Draw(StreamBuffer *stream, float viewLeft, float viewRight, float viewBottom, float viewTop) {
+	if (indexTexture == 0) {
+		return;
+	}
+	program->Use();
+	if (uniformsDirty) {
+		glUniform2f(mapSizeUniform, (float)mapWidth, (float)mapHeight);
+		glUniform2f(spriteCountUniform, (float)spriteCountX, (float)spriteCountY);
+		glUniform4f(atlasRectUniform, atlasRegion.u, atlasRegion.v, atlasRegion.width, atlasRegion.height);
+		glUniform1f(emptyTileUniform, (float)TILE_EMPTY);
+		uniformsDirty = false;
+	}
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, indexTexture);
+	if (!dirtyTiles.empty()) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < dirtyTiles.size(); i++) {
+			UploadTile(dirtyTiles[i] % mapWidth, dirtyTiles[i] / mapWidth);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		dirtyTiles.clear();
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	// one quad over the view, with texCoords in tile units for the fragment shader
+	float quad[MESH_FLOATS_PER_QUAD];
+	Mesh::WriteQuad(quad, viewLeft, viewTop, viewRight, viewBottom, viewLeft / tileSize, -viewTop / tileSize,
+		(viewRight - viewLeft) / tileSize, (viewTop - viewBottom) / tileSize);
+	int firstQuad = stream->WriteQuads(quad, 1, MESH_FLOATS_PER_QUAD);
+	viewQuad.Attach(stream->buffer, stream->QuadCapacity(MESH_FLOATS_PER_QUAD));
+	viewQuad.Draw(program, firstQuad, 1);
+}
+
+void ShaderTileMap::Cleanup() {
+	if (indexTexture != 0) {
+		glDeleteTextures(1, &indexTexture);
+		indexTexture = 0;
+	}
+	viewQuad.Cleanup();
+}
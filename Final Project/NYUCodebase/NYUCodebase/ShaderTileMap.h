@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "TextureAtlas.h"
+#include "Mesh.h"
+#include "TileMesh.h"
+#include "StreamBuffer.h"
+
+// Tile layer drawn by a fragment shader instead of per-tile geometry. The map is kept in a
+// texture with one texel per tile holding its index, and a single quad over the view looks
+// each pixel's tile up in it, so the cost follows screen size rather than map size and a
+// changed tile re-uploads one texel.
+class ShaderTileMap {
+	public:
+		ShaderTileMap();
+
+		void Load(ShaderProgram *program);
+		void Build(const int *tiles, int mapWidth, int mapHeight, int spriteCountX, int spriteCountY, float tileSize);
+		void SetAtlasRegion(const AtlasRegion &region);
+		void SetTile(int gridX, int gridY, int value);
+		void Draw(StreamBuffer *stream, float viewLeft, float viewRight, float viewBottom, float viewTop);
+		void Cleanup();
+
+		ShaderProgram *program;
+
+	private:
+		void UploadTile(int gridX, int gridY);
+
+		GLuint indexTexture;
+		GLint mapSizeUniform;
+		GLint spriteCountUniform;
+		GLint atlasRectUniform;
+		GLint emptyTileUniform;
+		Mesh viewQuad;
+
+		std::vector<int> tiles;
+		int mapWidth;
+		int mapHeight;
+		int spriteCountX;
+		int spriteCountY;
+		float tileSize;
+		AtlasRegion atlasRegion;
+		bool uniformsDirty;
+		std::vector<int> dirtyTiles;
+};
@@ -0,0 +1,56 @@
+#include "SpriteBatch.h"
+
+SpriteBatch::SpriteBatch() {
+	mesh = Mesh(MESH_TINTED);
+	program = nullptr;
+	textureID = 0;
+	stream = nullptr;
+	drawCalls = 0;
+	quadCount = 0;
+}
+
+void SpriteBatch::Begin(ShaderProgram *program) {
+	Flush();
+	this->program = program;
+}
+
+void SpriteBatch::DrawQuad(GLuint textureID, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight, const float *tint) {
+	// flat quads never sample, so only a second texture has to start a new batch
+	if (textureID != 0 && textureID != this->textureID) {
+		if (this->textureID != 0) {
+			Flush();
+		}
+		this->textureID = textureID;
+	}
+	float left = x - 0.5f * width;
+	float right = x + 0.5f * width;
+	float top = y + 0.5f * height;
+	float bottom = y - 0.5f * height;
+	vertexData.resize(vertexData.size() + MESH_TINTED_FLOATS_PER_QUAD);
+	Mesh::WriteTintedQuad(&vertexData[vertexData.size() - MESH_TINTED_FLOATS_PER_QUAD], left, top, right, bottom, u, v, uWidth, vHeight, tint, textureID != 0 ? 1.0f : 0.0f);
+	quadCount++;
+}
+
+void SpriteBatch::End() {
+	Flush();
+}
+
+void SpriteBatch::Flush() {
+	if (vertexData.empty() || program == nullptr) {
+		return;
+	}
+	int quads = (int)(vertexData.size() / MESH_TINTED_FLOATS_PER_QUAD);
+	Matrix modelMatrix;
+	program->Use();
+	program->SetModelMatrix(modelMatrix);
+	ShaderProgram::BindTexture(textureID);
+	int firstQuad = stream->WriteQuads(vertexData.data(), quads, MESH_TINTED_FLOATS_PER_QUAD);
+	mesh.Attach(stream->buffer, stream->QuadCapacity(MESH_TINTED_FLOATS_PER_QUAD));
+	mesh.Draw(program, firstQuad, quads);
+	vertexData.clear();
+	drawCalls++;
+}
+
+void SpriteBatch::Cleanup() {
+	mesh.Cleanup();
+}
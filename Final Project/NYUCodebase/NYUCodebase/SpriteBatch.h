@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "Matrix.h"
+#include "ShaderProgram.h"
+#include "Mesh.h"
+#include "StreamBuffer.h"
+
+// Collects quads into one interleaved position/texCoord/tint stream, written into the
+// StreamBuffer with a single draw call per run of quads that share a program and texture.
+// Texture 0 draws flat tinted quads, which join whatever batch is open. drawCalls and
+// quadCount run from startup.
+class SpriteBatch {
+	public:
+		SpriteBatch();
+
+		void Begin(ShaderProgram *program);
+		void DrawQuad(GLuint textureID, float x, float y, float width, float height, float u, float v, float uWidth, float vHeight, const float *tint);
+		void End();
+		void Cleanup();
+
+		int drawCalls;
+		int quadCount;
+		StreamBuffer *stream;
+
+	private:
+		void Flush();
+
+		ShaderProgram *program;
+		GLuint textureID;
+		std::vector<float> vertexData;
+		Mesh mesh;
+};
@@ -0,0 +1,156 @@
+#include "StreamBuffer.h"
+#include <stdio.h>
+#include <string.h>
+#include <SDL.h>
+
+static bool versionAtLeast(int wantMajor, int wantMinor) {
+	int major = 0;
+	int minor = 0;
+	const char *version = (const char*)glGetString(GL_VERSION);
+	if (version != NULL) {
+		sscanf(version, "%d.%d", &major, &minor);
+	}
+	return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+StreamBuffer::StreamBuffer() {
+	buffer = 0;
+	mode = STREAM_ORPHAN;
+	stalls = 0;
+	segmentSize = STREAM_BUFFER_SEGMENT_SIZE;
+	segment = 0;
+	offset = 0;
+	mapped = nullptr;
+	for (int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+		fences[i] = 0;
+	}
+}
+
+void StreamBuffer::Create() {
+	bool sync = versionAtLeast(3, 2) || SDL_GL_ExtensionSupported("GL_ARB_sync");
+	if (sync && (versionAtLeast(4, 4) || SDL_GL_ExtensionSupported("GL_ARB_buffer_storage"))) {
+		mode = STREAM_PERSISTENT;
+	}
+	else if (sync && (versionAtLeast(3, 0) || SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range"))) {
+		mode = STREAM_UNSYNCHRONIZED;
+	}
+	else {
+		mode = STREAM_ORPHAN;
+	}
+
+	GLsizeiptr size = segmentSize * STREAM_BUFFER_SEGMENTS;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (mode == STREAM_PERSISTENT) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	segment = 0;
+	offset = 0;
+}
+
+void StreamBuffer::Destroy() {
+	for (int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+		if (fences[i] != 0) {
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+	if (buffer != 0) {
+		if (mapped != nullptr) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void StreamBuffer::BeginFrame() {
+	if (buffer == 0) {
+		Create();
+		return;
+	}
+	if (mode == STREAM_ORPHAN) {
+		// without fences the whole store is replaced instead, which the driver can do without a stall
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, segmentSize * STREAM_BUFFER_SEGMENTS, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	segment = (segment + 1) % STREAM_BUFFER_SEGMENTS;
+	offset = segment * segmentSize;
+	GLsync fence = fences[segment];
+	if (fence != 0) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			while (result == GL_TIMEOUT_EXPIRED) {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			}
+		}
+		glDeleteSync(fence);
+		fences[segment] = 0;
+	}
+}
+
+void StreamBuffer::EndFrame() {
+	if (buffer != 0 && mode != STREAM_ORPHAN) {
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+GLintptr StreamBuffer::Write(const void *data, GLsizeiptr size, GLsizeiptr alignment) {
+	if (buffer == 0) {
+		Create();
+	}
+	GLintptr writeOffset = (offset + alignment - 1) / alignment * alignment;
+	if (writeOffset + size > (segment + 1) * segmentSize) {
+		// out of room this frame; draws already issued keep the old store alive until they finish
+		Destroy();
+		while (segmentSize < size) {
+			segmentSize *= 2;
+		}
+		segmentSize *= 2;
+		Create();
+		writeOffset = 0;
+	}
+	if (mode == STREAM_PERSISTENT) {
+		memcpy((char*)mapped + writeOffset, data, size);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (mode == STREAM_UNSYNCHRONIZED) {
+			void *target = glMapBufferRange(GL_ARRAY_BUFFER, writeOffset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+			memcpy(target, data, size);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, writeOffset, size, data);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	offset = writeOffset + size;
+	return writeOffset;
+}
+
+int StreamBuffer::WriteQuads(const float *quadData, int quadCount, int floatsPerQuad) {
+	// starting on a whole quad lets the shared quad indices address the quads from the buffer start
+	GLsizeiptr quadSize = floatsPerQuad * sizeof(float);
+	return (int)(Write(quadData, quadCount * quadSize, quadSize) / quadSize);
+}
+
+int StreamBuffer::QuadCapacity(int floatsPerQuad) const {
+	return (int)(segmentSize * STREAM_BUFFER_SEGMENTS / (floatsPerQuad * sizeof(float)));
+}
+
+void StreamBuffer::Cleanup() {
+	Destroy();
+	segmentSize = STREAM_BUFFER_SEGMENT_SIZE;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+
+#define STREAM_BUFFER_SEGMENTS 3
+#define STREAM_BUFFER_SEGMENT_SIZE (1024 * 1024)
+#define STREAM_BUFFER_ALIGNMENT 16
+
+// STREAM_PERSISTENT keeps the buffer mapped for its whole life (GL 4.4 / ARB_buffer_storage),
+// STREAM_UNSYNCHRONIZED maps each write without waiting (GL 3.0 / ARB_map_buffer_range) and
+// STREAM_ORPHAN falls back to orphaning the store once a frame and glBufferSubData.
+enum StreamMode { STREAM_PERSISTENT, STREAM_UNSYNCHRONIZED, STREAM_ORPHAN };
+
+// One vertex buffer split into STREAM_BUFFER_SEGMENTS per-frame segments that dynamic geometry
+// is written into back to back. A fence placed at the end of each frame guards its segment,
+// so the CPU only ever waits when it laps a segment the GPU has not finished reading.
+class StreamBuffer {
+	public:
+		StreamBuffer();
+
+		void BeginFrame();
+		void EndFrame();
+		GLintptr Write(const void *data, GLsizeiptr size, GLsizeiptr alignment = STREAM_BUFFER_ALIGNMENT);
+		int WriteQuads(const float *quadData, int quadCount, int floatsPerQuad);
+		int QuadCapacity(int floatsPerQuad) const;
+		void Cleanup();
+
+		GLuint buffer;
+		StreamMode mode;
+		int stalls;
+
+	private:
+		void Create();
+		void Destroy();
+
+		GLsizeiptr segmentSize;
+		int segment;
+		GLintptr offset;
+		void *mapped;
+		GLsync fences[STREAM_BUFFER_SEGMENTS];
+};
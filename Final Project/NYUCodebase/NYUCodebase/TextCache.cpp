@@ -0,0 +1,92 @@
+#include "TextCache.h"
+#include <string.h>
+#include <vector>
+
+bool TextKey::operator==(const TextKey &other) const {
+	return textID == other.textID && size == other.size && spacing == other.spacing && u == other.u && v == other.v;
+}
+
+size_t TextKeyHash::operator()(const TextKey &key) const {
+	uint32_t words[5];
+	memcpy(words, &key.textID, sizeof(uint32_t));
+	memcpy(words + 1, &key.size, sizeof(float));
+	memcpy(words + 2, &key.spacing, sizeof(float));
+	memcpy(words + 3, &key.u, sizeof(float));
+	memcpy(words + 4, &key.v, sizeof(float));
+	// FNV-1a over the five words
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < 5; i++) {
+		hash = (hash ^ words[i]) * 16777619u;
+	}
+	return hash;
+}
+
+void TextRun::Draw(ShaderProgram *program, float x, float y) {
+	Matrix modelMatrix;
+	modelMatrix.Translate(x, y, 0.0f);
+	program->SetModelMatrix(modelMatrix);
+	mesh.Draw(program, 0, quadCount);
+}
+
+TextCache::TextCache(size_t capacity) {
+	this->capacity = capacity;
+	frame = 0;
+	hits = 0;
+	misses = 0;
+}
+
+void TextCache::BeginFrame() {
+	frame++;
+}
+
+TextRun *TextCache::Get(const AtlasRegion &fontRegion, uint32_t textID, const char *text, size_t length, float size, float spacing) {
+	TextKey key;
+	key.textID = textID;
+	key.size = size;
+	key.spacing = spacing;
+	key.u = fontRegion.u;
+	key.v = fontRegion.v;
+	auto found = lookup.find(key);
+	if (found != lookup.end()) {
+		entries.splice(entries.begin(), entries, found->second);
+		found->second->second.lastUsedFrame = frame;
+		hits++;
+		return &found->second->second;
+	}
+	misses++;
+
+	std::vector<float> vertexData(length * MESH_FLOATS_PER_QUAD);
+	float u, v, width, height;
+	float half = 0.5f * size;
+	for (size_t i = 0; i < length; i++) {
+		fontRegion.MapCell((int)text[i], 16, 16, u, v, width, height);
+		float center = (size + spacing) * i;
+		Mesh::WriteQuad(&vertexData[i * MESH_FLOATS_PER_QUAD], center - half, half, center + half, -half, u, v, width, height);
+	}
+
+	TextRun run;
+	run.quadCount = (int)length;
+	run.lastUsedFrame = frame;
+	run.mesh.Upload(vertexData.data(), run.quadCount, GL_STATIC_DRAW);
+
+	entries.push_front(Entry(key, run));
+	lookup[key] = entries.begin();
+	Evict();
+	return &entries.front().second;
+}
+
+void TextCache::Evict() {
+	while (entries.size() > capacity && entries.back().second.lastUsedFrame != frame) {
+		entries.back().second.mesh.Cleanup();
+		lookup.erase(entries.back().first);
+		entries.pop_back();
+	}
+}
+
+void TextCache::Cleanup() {
+	for (auto it = entries.begin(); it != entries.end(); ++it) {
+		it->second.mesh.Cleanup();
+	}
+	entries.clear();
+	lookup.clear();
+}
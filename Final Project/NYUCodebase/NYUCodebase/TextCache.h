@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+#include "ShaderProgram.h"
+#include "TextureAtlas.h"
+#include "Mesh.h"
+
+#define TEXT_CACHE_CAPACITY 32
+
+// Glyph quads for one string laid out from the origin, kept in a static Mesh.
+struct TextRun {
+	void Draw(ShaderProgram *program, float x, float y);
+
+	Mesh mesh;
+	int quadCount;
+	int lastUsedFrame;
+};
+
+// A string by the id the RenderQueue interned it under, plus everything else that changes
+// its layout. Plain values, so looking one up never allocates.
+struct TextKey {
+	bool operator==(const TextKey &other) const;
+
+	uint32_t textID;
+	float size;
+	float spacing;
+	float u;
+	float v;
+};
+
+struct TextKeyHash {
+	size_t operator()(const TextKey &key) const;
+};
+
+// Keeps a ready TextRun per (string, size, spacing) so static strings are laid out and
+// uploaded once. Least recently used runs are evicted past the capacity, but never a
+// run that was requested during the current frame since the queue may still draw it.
+// The characters are only read on a miss.
+class TextCache {
+	public:
+		TextCache(size_t capacity = TEXT_CACHE_CAPACITY);
+
+		void BeginFrame();
+		TextRun *Get(const AtlasRegion &fontRegion, uint32_t textID, const char *text, size_t length, float size, float spacing);
+		void Cleanup();
+
+		int hits;
+		int misses;
+
+	private:
+		typedef std::pair<TextKey, TextRun> Entry;
+
+		void Evict();
+
+		size_t capacity;
+		int frame;
+		std::list<Entry> entries;
+		std::unordered_map<TextKey, std::list<Entry>::iterator, TextKeyHash> lookup;
+};
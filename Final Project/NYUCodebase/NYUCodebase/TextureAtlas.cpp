@@ -0,0 +1,126 @@
+#include "TextureAtlas.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+AtlasRegion::AtlasRegion() {
+	u = 0.0f;
+	v = 0.0f;
+	width = 1.0f;
+	height = 1.0f;
+}
+
+AtlasRegion::AtlasRegion(float u, float v, float width, float height) {
+	this->u = u;
+	this->v = v;
+	this->width = width;
+	this->height = height;
+}
+
+void AtlasRegion::MapCell(int index, int spriteCountX, int spriteCountY, float &cellU, float &cellV, float &cellWidth, float &cellHeight) const {
+	cellWidth = width / (float)spriteCountX;
+	cellHeight = height / (float)spriteCountY;
+	cellU = u + (float)(index % spriteCountX) * cellWidth;
+	cellV = v + (float)(index / spriteCountX) * cellHeight;
+}
+
+TextureAtlas::TextureAtlas() {
+	textureID = 0;
+	width = 0;
+	height = 0;
+}
+
+void TextureAtlas::Add(const std::string &filePath) {
+	AtlasImage image;
+	int comp;
+	image.filePath = filePath;
+	image.pixels = stbi_load(filePath.c_str(), &image.width, &image.height, &comp, STBI_rgb_alpha);
+	if (image.pixels == NULL) {
+		std::cout << "Unable to load image. Make sure the path is correct\n";
+		assert(false);
+	}
+	image.x = 0;
+	image.y = 0;
+	images.push_back(image);
+}
+
+GLuint TextureAtlas::Pack(int padding, ResourceManager &resources, const TextureOptions &options) {
+	// shelf packing, tallest sheets first
+	std::vector<size_t> order;
+	int maxWidth = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		order.push_back(i);
+		maxWidth = std::max(maxWidth, images[i].width + 2 * padding);
+	}
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return images[a].height > images[b].height; });
+
+	width = 1;
+	while (width < maxWidth) {
+		width *= 2;
+	}
+	int shelfX = 0;
+	int shelfY = 0;
+	int shelfHeight = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		AtlasImage &image = images[order[i]];
+		int paddedWidth = image.width + 2 * padding;
+		int paddedHeight = image.height + 2 * padding;
+		if (shelfX + paddedWidth > width) {
+			shelfY += shelfHeight;
+			shelfX = 0;
+			shelfHeight = 0;
+		}
+		image.x = shelfX + padding;
+		image.y = shelfY + padding;
+		shelfX += paddedWidth;
+		shelfHeight = std::max(shelfHeight, paddedHeight);
+	}
+	height = 1;
+	while (height < shelfY + shelfHeight) {
+		height *= 2;
+	}
+
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (width > maxTextureSize || height > maxTextureSize) {
+		std::cout << "Texture atlas " << width << "x" << height << " exceeds GL_MAX_TEXTURE_SIZE\n";
+		assert(false);
+	}
+
+	std::vector<unsigned char> atlasPixels(width * height * 4, 0);
+	for (size_t i = 0; i < images.size(); i++) {
+		const AtlasImage &image = images[i];
+		for (int y = -padding; y < image.height + padding; y++) {
+			int sourceY = std::min(std::max(y, 0), image.height - 1);
+			for (int x = -padding; x < image.width + padding; x++) {
+				int sourceX = std::min(std::max(x, 0), image.width - 1);
+				const unsigned char *source = image.pixels + (sourceY * image.width + sourceX) * 4;
+				unsigned char *dest = atlasPixels.data() + ((image.y + y) * width + image.x + x) * 4;
+				std::copy(source, source + 4, dest);
+			}
+		}
+		stbi_image_free(image.pixels);
+		images[i].pixels = nullptr;
+	}
+
+	// the same set of sheets packs to the same atlas, so it is shared by name
+	std::string name = "atlas";
+	for (size_t i = 0; i < images.size(); i++) {
+		name += (i == 0 ? ":" : ",") + images[i].filePath;
+	}
+	textureID = resources.CreateTexture(name, atlasPixels.data(), width, height, options);
+	return textureID;
+}
+
+AtlasRegion TextureAtlas::GetRegion(const std::string &filePath) const {
+	for (size_t i = 0; i < images.size(); i++) {
+		if (images[i].filePath == filePath) {
+			const AtlasImage &image = images[i];
+			return AtlasRegion((float)image.x / width, (float)image.y / height, (float)image.width / width, (float)image.height / height);
+		}
+	}
+	std::cout << "Image " << filePath << " was not added to the atlas\n";
+	assert(false);
+	return AtlasRegion();
+}
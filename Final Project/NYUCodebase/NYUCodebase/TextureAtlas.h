@@ -0,0 +1,49 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+#include "ResourceManager.h"
+
+// Normalized rectangle of a source image inside the packed atlas texture.
+struct AtlasRegion {
+	AtlasRegion();
+	AtlasRegion(float u, float v, float width, float height);
+
+	void MapCell(int index, int spriteCountX, int spriteCountY, float &cellU, float &cellV, float &cellWidth, float &cellHeight) const;
+
+	float u;
+	float v;
+	float width;
+	float height;
+};
+
+// Packs several sprite sheets into one RGBA texture at load time, with a border of
+// duplicated edge pixels around every sheet so filtering never samples a neighbour.
+class TextureAtlas {
+	public:
+		TextureAtlas();
+
+		void Add(const std::string &filePath);
+		GLuint Pack(int padding, ResourceManager &resources, const TextureOptions &options);
+		AtlasRegion GetRegion(const std::string &filePath) const;
+
+		GLuint textureID;
+		int width;
+		int height;
+
+	private:
+		struct AtlasImage {
+			std::string filePath;
+			unsigned char *pixels;
+			int width;
+			int height;
+			int x;
+			int y;
+		};
+
+		std::vector<AtlasImage> images;
+};
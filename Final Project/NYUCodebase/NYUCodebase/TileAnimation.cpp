@@ -0,0 +1,72 @@
+#include "TileAnimation.h"
+#include <algorithm>
+
+TileAnimationTable::TileAnimationTable() {
+	animatedTiles = 0;
+	texture = 0;
+	rows = 1;
+	spriteCountX = 1;
+}
+
+void TileAnimationTable::Configure(int spriteCountX, int spriteCountY) {
+	this->spriteCountX = spriteCountX;
+	rows = 1;
+	while (rows < spriteCountX * spriteCountY) {
+		rows *= 2;
+	}
+}
+
+void TileAnimationTable::Attach(ShaderProgram *program) {
+	program->Use();
+	glUniform1i(program->animationTableUniform, TILE_ANIMATION_UNIT);
+	glUniform2f(program->animationTableSizeUniform, (float)TILE_ANIMATION_TABLE_WIDTH, (float)rows);
+	glUniform1f(program->animationColumnsUniform, (float)spriteCountX);
+}
+
+void TileAnimationTable::Build(const std::vector<FlareMapAnimation> &animations) {
+	// two bytes per texel like the tilemap's index texture: low in luminance, high in alpha
+	texels.assign(TILE_ANIMATION_TABLE_WIDTH * rows * 2, 0);
+	animatedTiles = 0;
+	for (size_t i = 0; i < animations.size(); i++) {
+		const FlareMapAnimation &animation = animations[i];
+		if (animation.tile >= rows) {
+			continue;
+		}
+		int frameCount = std::min((int)animation.frames.size(), TILE_ANIMATION_MAX_FRAMES);
+		unsigned char *row = &texels[animation.tile * TILE_ANIMATION_TABLE_WIDTH * 2];
+		row[0] = (unsigned char)frameCount;
+		row[1] = (unsigned char)std::min(std::max((int)(animation.frameDuration * 100.0f + 0.5f), 1), 255);
+		for (int frame = 0; frame < frameCount; frame++) {
+			row[(frame + 1) * 2] = (unsigned char)(animation.frames[frame] & 0xFF);
+			row[(frame + 1) * 2 + 1] = (unsigned char)(animation.frames[frame] >> 8);
+		}
+		animatedTiles++;
+	}
+
+	if (texture == 0) {
+		glGenTextures(1, &texture);
+	}
+	glActiveTexture(GL_TEXTURE0 + TILE_ANIMATION_UNIT);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, TILE_ANIMATION_TABLE_WIDTH, rows, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// Called once per tile layer draw; the time only changes between frames, so the program's
+// cache skips the upload for every draw after the first.
+void TileAnimationTable::Apply(ShaderProgram *program, float time) {
+	program->SetAnimationTime(time);
+}
+
+void TileAnimationTable::Cleanup() {
+	if (texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+}
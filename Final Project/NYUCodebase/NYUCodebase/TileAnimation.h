@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "FlareMap.h"
+
+#define TILE_ANIMATION_TABLE_WIDTH 16
+#define TILE_ANIMATION_MAX_FRAMES (TILE_ANIMATION_TABLE_WIDTH - 1)
+#define TILE_ANIMATION_UNIT 2
+
+// Frame lists of a level's animated tiles, kept in a texture the tile shaders read. Row t
+// holds tile t's frame count and centiseconds per frame in its first texel and the frame
+// tiles after it, so the shaders pick the current frame from a time uniform and neither the
+// tile geometry nor the map data changes while tiles animate. The table's size only depends
+// on the sheet, so Configure fixes it and Attach hands it to each tile program once at load;
+// the table texture stays bound to TILE_ANIMATION_UNIT and per draw only the time changes.
+class TileAnimationTable {
+	public:
+		TileAnimationTable();
+
+		void Configure(int spriteCountX, int spriteCountY);
+		void Attach(ShaderProgram *program);
+		void Build(const std::vector<FlareMapAnimation> &animations);
+		void Apply(ShaderProgram *program, float time);
+		void Cleanup();
+
+		int animatedTiles;
+
+	private:
+		GLuint texture;
+		int rows;
+		int spriteCountX;
+		std::vector<unsigned char> texels;
+};
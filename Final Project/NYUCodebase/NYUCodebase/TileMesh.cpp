@@ -0,0 +1,215 @@
+#include "TileMesh.h"
+#include <algorithm>
+#include <math.h>
+
+#define CHUNK_QUAD_CAPACITY (TILE_CHUNK_SIZE * TILE_CHUNK_SIZE)
+
+TileMesh::TileMesh() {
+	mesh = Mesh(MESH_WRAPPED);
+	greedy = true;
+	mapWidth = 0;
+	mapHeight = 0;
+	chunksX = 0;
+	chunksY = 0;
+	packedQuads = 0;
+	overflowSlots = 0;
+	usedSlots = 0;
+}
+
+TileMesh::~TileMesh() {
+}
+
+void TileMesh::Build(const int *tiles, int mapWidth, int mapHeight, int spriteCountX, int spriteCountY, float tileSize) {
+	this->tiles.assign(tiles, tiles + mapWidth * mapHeight);
+	this->mapWidth = mapWidth;
+	this->mapHeight = mapHeight;
+	this->spriteCountX = spriteCountX;
+	this->spriteCountY = spriteCountY;
+	this->tileSize = tileSize;
+	Rebuild();
+}
+
+void TileMesh::Rebuild() {
+	chunksX = (mapWidth + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	chunksY = (mapHeight + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	int chunkCount = chunksX * chunksY;
+	chunkFirstQuad.assign(chunkCount, 0);
+	chunkCapacity.assign(chunkCount, 0);
+	chunkSlot.assign(chunkCount, -1);
+	chunkQuads.assign(chunkCount, 0);
+	chunkTiles.assign(chunkCount, 0);
+	chunkDirty.assign(chunkCount, false);
+	dirtyChunks.clear();
+	chunkScratch.resize(CHUNK_QUAD_CAPACITY * MESH_WRAPPED_FLOATS_PER_QUAD);
+
+	// chunks are packed back to back in row-major order, so a row of visible chunks is one range
+	std::vector<float> quadData;
+	int totalQuads = 0;
+	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++) {
+		int quadCount = FillChunk(chunkIndex % chunksX, chunkIndex / chunksX, chunkScratch.data(), chunkTiles[chunkIndex]);
+		chunkFirstQuad[chunkIndex] = totalQuads;
+		chunkCapacity[chunkIndex] = quadCount;
+		chunkQuads[chunkIndex] = quadCount;
+		quadData.insert(quadData.end(), chunkScratch.begin(), chunkScratch.begin() + quadCount * MESH_WRAPPED_FLOATS_PER_QUAD);
+		totalQuads += quadCount;
+	}
+	// overflow slots start zeroed, which draws as degenerate triangles until a chunk moves in
+	packedQuads = totalQuads;
+	overflowSlots = std::max(TILE_MIN_OVERFLOW_SLOTS, chunkCount / 4);
+	usedSlots = 0;
+	quadData.resize((packedQuads + overflowSlots * CHUNK_QUAD_CAPACITY) * MESH_WRAPPED_FLOATS_PER_QUAD, 0.0f);
+	mesh.Upload(quadData.data(), packedQuads + overflowSlots * CHUNK_QUAD_CAPACITY, GL_DYNAMIC_DRAW);
+}
+
+void TileMesh::SetAtlasRegion(const AtlasRegion &region) {
+	atlasRegion = region;
+}
+
+int TileMesh::FillChunk(int chunkX, int chunkY, float *quadData, int &tileCount) {
+	float u, v, spriteWidth, spriteHeight;
+	int startX = chunkX * TILE_CHUNK_SIZE;
+	int startY = chunkY * TILE_CHUNK_SIZE;
+	int endY = std::min(startY + TILE_CHUNK_SIZE, mapHeight);
+	int endX = std::min(startX + TILE_CHUNK_SIZE, mapWidth);
+	merged.assign(TILE_CHUNK_SIZE * TILE_CHUNK_SIZE, false);
+	int quadCount = 0;
+	tileCount = 0;
+	for (int y = startY; y < endY; y++) {
+		for (int x = startX; x < endX; x++) {
+			int tile = tiles[y * mapWidth + x];
+			if (tile == 0 || tile == TILE_EMPTY) {
+				continue;
+			}
+			tileCount++;
+			if (merged[(y - startY) * TILE_CHUNK_SIZE + x - startX]) {
+				continue;
+			}
+			// grow right along the row, then down while the whole span still matches
+			int width = 1;
+			int height = 1;
+			if (greedy) {
+				while (x + width < endX && tiles[y * mapWidth + x + width] == tile && !merged[(y - startY) * TILE_CHUNK_SIZE + x + width - startX]) {
+					width++;
+				}
+				while (y + height < endY) {
+					int spanX = 0;
+					while (spanX < width && tiles[(y + height) * mapWidth + x + spanX] == tile && !merged[(y + height - startY) * TILE_CHUNK_SIZE + x + spanX - startX]) {
+						spanX++;
+					}
+					if (spanX < width) {
+						break;
+					}
+					height++;
+				}
+				for (int mergeY = 0; mergeY < height; mergeY++) {
+					for (int mergeX = 0; mergeX < width; mergeX++) {
+						merged[(y + mergeY - startY) * TILE_CHUNK_SIZE + x + mergeX - startX] = true;
+					}
+				}
+			}
+			atlasRegion.MapCell(tile, spriteCountX, spriteCountY, u, v, spriteWidth, spriteHeight);
+			float left = tileSize * x;
+			float right = left + tileSize * width;
+			float top = -tileSize * y;
+			float bottom = top - tileSize * height;
+			Mesh::WriteWrappedQuad(quadData + quadCount * MESH_WRAPPED_FLOATS_PER_QUAD, left, top, right, bottom, (float)width, (float)height, u, v, spriteWidth, spriteHeight, (float)tile);
+			quadCount++;
+		}
+	}
+	return quadCount;
+}
+
+void TileMesh::SetTile(int gridX, int gridY, int value) {
+	if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight) {
+		return;
+	}
+	tiles[gridY * mapWidth + gridX] = value;
+	int chunkIndex = (gridY / TILE_CHUNK_SIZE) * chunksX + gridX / TILE_CHUNK_SIZE;
+	if (!chunkDirty[chunkIndex]) {
+		chunkDirty[chunkIndex] = true;
+		dirtyChunks.push_back(chunkIndex);
+	}
+}
+
+bool TileMesh::UploadChunk(int chunkIndex) {
+	int quadCount = FillChunk(chunkIndex % chunksX, chunkIndex / chunksX, chunkScratch.data(), chunkTiles[chunkIndex]);
+	if (chunkSlot[chunkIndex] == -1 && quadCount > chunkCapacity[chunkIndex]) {
+		if (usedSlots == overflowSlots) {
+			return false;
+		}
+		// blank the packed range so the row draws skip it, then move the chunk to a slot
+		std::vector<float> blank(chunkCapacity[chunkIndex] * MESH_WRAPPED_FLOATS_PER_QUAD, 0.0f);
+		if (!blank.empty()) {
+			mesh.UploadRange(chunkFirstQuad[chunkIndex], blank.data(), chunkCapacity[chunkIndex]);
+		}
+		chunkSlot[chunkIndex] = usedSlots++;
+	}
+	int firstQuad = chunkFirstQuad[chunkIndex];
+	int capacity = chunkCapacity[chunkIndex];
+	if (chunkSlot[chunkIndex] != -1) {
+		firstQuad = packedQuads + chunkSlot[chunkIndex] * CHUNK_QUAD_CAPACITY;
+		capacity = CHUNK_QUAD_CAPACITY;
+	}
+	chunkQuads[chunkIndex] = quadCount;
+	// zero the unused tail so merged row draws only see degenerate triangles there
+	std::fill(chunkScratch.begin() + quadCount * MESH_WRAPPED_FLOATS_PER_QUAD, chunkScratch.begin() + capacity * MESH_WRAPPED_FLOATS_PER_QUAD, 0.0f);
+	mesh.UploadRange(firstQuad, chunkScratch.data(), capacity);
+	chunkDirty[chunkIndex] = false;
+	return true;
+}
+
+void TileMesh::Draw(ShaderProgram *program, float viewLeft, float viewRight, float viewBottom, float viewTop) {
+	if (chunksX == 0) {
+		return;
+	}
+	for (size_t i = 0; i < dirtyChunks.size(); i++) {
+		if (!UploadChunk(dirtyChunks[i])) {
+			// every overflow slot is taken, repack the whole layer with the new sizes
+			Rebuild();
+			break;
+		}
+	}
+	dirtyChunks.clear();
+
+	float chunkSize = tileSize * TILE_CHUNK_SIZE;
+	int minChunkX = std::max((int)floorf(viewLeft / chunkSize), 0);
+	int maxChunkX = std::min((int)floorf(viewRight / chunkSize), chunksX - 1);
+	int minChunkY = std::max((int)floorf(-viewTop / chunkSize), 0);
+	int maxChunkY = std::min((int)floorf(-viewBottom / chunkSize), chunksY - 1);
+	if (minChunkX > maxChunkX || minChunkY > maxChunkY) {
+		return;
+	}
+
+	for (int chunkY = minChunkY; chunkY <= maxChunkY; chunkY++) {
+		int firstChunk = chunkY * chunksX + minChunkX;
+		int lastChunk = chunkY * chunksX + maxChunkX;
+		int first = chunkFirstQuad[firstChunk];
+		mesh.Draw(program, first, chunkFirstQuad[lastChunk] + chunkCapacity[lastChunk] - first);
+		for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX++) {
+			int slot = chunkSlot[chunkY * chunksX + chunkX];
+			if (slot != -1 && chunkQuads[chunkY * chunksX + chunkX] > 0) {
+				mesh.Draw(program, packedQuads + slot * CHUNK_QUAD_CAPACITY, chunkQuads[chunkY * chunksX + chunkX]);
+			}
+		}
+	}
+}
+
+int TileMesh::GetTileCount() const {
+	int count = 0;
+	for (size_t i = 0; i < chunkTiles.size(); i++) {
+		count += chunkTiles[i];
+	}
+	return count;
+}
+
+int TileMesh::GetQuadCount() const {
+	int count = 0;
+	for (size_t i = 0; i < chunkQuads.size(); i++) {
+		count += chunkQuads[i];
+	}
+	return count;
+}
+
+void TileMesh::Cleanup() {
+	mesh.Cleanup();
+}
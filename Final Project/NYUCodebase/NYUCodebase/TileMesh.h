@@ -0,0 +1,68 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "TextureAtlas.h"
+#include "Mesh.h"
+
+#define TILE_CHUNK_SIZE 16
+#define TILE_EMPTY 360
+#define TILE_MIN_OVERFLOW_SLOTS 4
+
+// Tile layer geometry kept in a single Mesh. Every chunk of TILE_CHUNK_SIZE x TILE_CHUNK_SIZE
+// tiles owns a range of quads sized to its occupied tiles, so a changed tile only
+// re-uploads its own chunk and drawing only touches the chunks inside the view. With
+// greedy set, each chunk merges rectangles of identical tiles into single quads that
+// repeat the tile's atlas cell. A chunk that outgrows its range moves to one of the
+// overflow slots after the packed ranges, each big enough for a full chunk, so growth
+// still only re-uploads that chunk.
+class TileMesh {
+	public:
+		TileMesh();
+		~TileMesh();
+
+		void Build(const int *tiles, int mapWidth, int mapHeight, int spriteCountX, int spriteCountY, float tileSize);
+		void SetAtlasRegion(const AtlasRegion &region);
+		void SetTile(int gridX, int gridY, int value);
+		void Draw(ShaderProgram *program, float viewLeft, float viewRight, float viewBottom, float viewTop);
+		void Cleanup();
+
+		int GetTileCount() const;
+		int GetQuadCount() const;
+
+		bool greedy;
+
+	private:
+		int FillChunk(int chunkX, int chunkY, float *quadData, int &tileCount);
+		bool UploadChunk(int chunkIndex);
+		void Rebuild();
+
+		Mesh mesh;
+
+		std::vector<int> tiles;
+		int mapWidth;
+		int mapHeight;
+		int spriteCountX;
+		int spriteCountY;
+		float tileSize;
+		AtlasRegion atlasRegion;
+
+		int chunksX;
+		int chunksY;
+		std::vector<int> chunkFirstQuad;
+		std::vector<int> chunkCapacity;
+		std::vector<int> chunkSlot;
+		std::vector<int> chunkQuads;
+		std::vector<int> chunkTiles;
+		std::vector<bool> merged;
+		std::vector<bool> chunkDirty;
+		std::vector<int> dirtyChunks;
+		std::vector<float> chunkScratch;
+		int packedQuads;
+		int overflowSlots;
+		int usedSlots;
+};
@@ -0,0 +1,52 @@
+#include "TileProperties.h"
+
+TileProperties::TileProperties() {
+	flaggedTiles = 0;
+}
+
+void TileProperties::Build(const std::vector<FlareMapTileProperty> &properties, int tileCount) {
+	flags.assign(tileCount, 0);
+	for (size_t i = 0; i < properties.size(); i++) {
+		const FlareMapTileProperty &property = properties[i];
+		if (property.tile < 0 || property.tile >= tileCount) {
+			continue;
+		}
+		for (size_t j = 0; j < property.flags.size(); j++) {
+			flags[property.tile] |= ParseFlag(property.flags[j]);
+		}
+	}
+	flaggedTiles = 0;
+	for (int tile = 0; tile < tileCount; tile++) {
+		if (flags[tile] != 0) {
+			flaggedTiles++;
+		}
+	}
+}
+
+unsigned char TileProperties::ParseFlag(const std::string &name) {
+	if (name == "solid") {
+		return TILE_SOLID;
+	}
+	else if (name == "wall") {
+		return TILE_WALL;
+	}
+	else if (name == "lethal") {
+		return TILE_LETHAL;
+	}
+	else if (name == "pickup") {
+		return TILE_PICKUP;
+	}
+	else if (name == "spring") {
+		return TILE_SPRING;
+	}
+	else if (name == "door") {
+		return TILE_DOOR;
+	}
+	else if (name == "switch") {
+		return TILE_SWITCH;
+	}
+	else if (name == "exit") {
+		return TILE_EXIT;
+	}
+	return 0;
+}
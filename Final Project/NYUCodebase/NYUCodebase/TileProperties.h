@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FlareMap.h"
+
+// one bit per gameplay property, so a probe can test several at once
+enum TileFlag {
+	TILE_SOLID = 1,
+	TILE_WALL = 2,
+	TILE_LETHAL = 4,
+	TILE_PICKUP = 8,
+	TILE_SPRING = 16,
+	TILE_DOOR = 32,
+	TILE_SWITCH = 64,
+	TILE_EXIT = 128
+};
+
+// Gameplay flags for every tile of the tileset, built once from the [tileproperties]
+// section of the tileset file. TILE_SOLID blocks movement on both axes, TILE_WALL only
+// sideways. flags is indexed directly by tile so collision probes are a load and a mask.
+class TileProperties {
+	public:
+		TileProperties();
+
+		void Build(const std::vector<FlareMapTileProperty> &properties, int tileCount);
+		static unsigned char ParseFlag(const std::string &name);
+
+		std::vector<unsigned char> flags;
+		int flaggedTiles;
+};
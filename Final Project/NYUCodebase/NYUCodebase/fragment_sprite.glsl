@@ -0,0 +1,28 @@
+uniform sampler2D diffuse;
+uniform vec4 color;
+varying vec2 texCoordVar;
+varying vec4 texCellVar;
+varying vec4 tintVar;
+varying float texturedVar;
+varying float tileVar;
+uniform float animationColumns;
+
+// in tile_animation.glsl
+float animatedTile(float tile);
+
+vec2 sheetCell(float tile) {
+	float row = floor((tile + 0.5) / animationColumns);
+	return vec2(tile - row * animationColumns, row);
+}
+
+void main() {
+	// merged tile quads repeat one atlas cell, their texCoordVar counts cells
+	vec2 cellOrigin = texCellVar.xy;
+	if (tileVar > 0.0) {
+		// an animated tile moves its cell by the current frame's offset in the sheet
+		cellOrigin += (sheetCell(animatedTile(tileVar)) - sheetCell(tileVar)) * texCellVar.zw;
+	}
+	vec2 uv = texCellVar.z > 0.0 ? cellOrigin + fract(texCoordVar) * texCellVar.zw : texCoordVar;
+	vec4 texel = texturedVar > 0.5 ? texture2D(diffuse, uv) : vec4(1.0);
+	gl_FragColor = texel * tintVar * color;
+}
\ No newline at end of file
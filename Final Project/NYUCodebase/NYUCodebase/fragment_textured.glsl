@@ -1,7 +1,10 @@
 
 uniform sampler2D diffuse;
 varying vec2 texCoordVar;
+varying vec4 texCellVar;
 
 void main() {
-    gl_FragColor = texture2D(diffuse, texCoordVar);
+	// merged tile quads repeat one atlas cell, their texCoordVar counts cells
+	vec2 uv = texCellVar.z > 0.0 ? texCellVar.xy + fract(texCoordVar) * texCellVar.zw : texCoordVar;
+    gl_FragColor = texture2D(diffuse, uv);
 }
\ No newline at end of file
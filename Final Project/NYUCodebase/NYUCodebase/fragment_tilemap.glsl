@@ -0,0 +1,28 @@
+uniform sampler2D diffuse;
+uniform sampler2D tileIndices;
+uniform vec2 mapSize;
+uniform vec2 spriteCount;
+uniform vec4 atlasRect;
+uniform float emptyTile;
+varying vec2 tileCoordVar;
+
+// in tile_animation.glsl
+float animatedTile(float tile);
+
+void main() {
+	vec2 tile = floor(tileCoordVar);
+	if (tile.x < 0.0 || tile.y < 0.0 || tile.x >= mapSize.x || tile.y >= mapSize.y) {
+		discard;
+	}
+	// tile index is stored as two bytes, low in luminance and high in alpha
+	vec4 texel = texture2D(tileIndices, (tile + 0.5) / mapSize);
+	float index = floor(texel.r * 255.0 + 0.5) + floor(texel.a * 255.0 + 0.5) * 256.0;
+	if (index == 0.0 || index == emptyTile) {
+		discard;
+	}
+	index = animatedTile(index);
+	float row = floor((index + 0.5) / spriteCount.x);
+	vec2 cell = vec2(index - row * spriteCount.x, row);
+	vec2 uv = (cell + fract(tileCoordVar)) / spriteCount;
+	gl_FragColor = texture2D(diffuse, atlasRect.xy + uv * atlasRect.zw);
+}
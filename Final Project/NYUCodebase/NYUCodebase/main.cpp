@@ -5,6 +5,8 @@
 #include <SDL_opengl.h>
 #include <SDL_image.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <vector>
 #include <iostream>
 #include <SDL_mixer.h>
@@ -12,6 +14,18 @@
 #include "Matrix.h"
 #include "ShaderProgram.h"
 #include "FlareMap.h"
+#include "TileMesh.h"
+#include "TextureAtlas.h"
+#include "RenderQueue.h"
+#include "OffscreenTarget.h"
+#include "ShaderTileMap.h"
+#include "RenderThread.h"
+#include "ResourceManager.h"
+#include "ResolutionScaler.h"
+#include "FrameCapture.h"
+#include "TileProperties.h"
+#include "EntityStore.h"
+#include "CollisionGrid.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define LEVEL_WIDTH 64
@@ -23,6 +37,13 @@
 #define FRICTION_Y 0.1f
 #define GRAVITY 9.8f
 #define ENEMY_GAP 1.0f
+#define COLLISION_CELL_TILES 2
+#define IDLE_WAIT_MS 1000
+#define UNFOCUSED_FRAME_MS 33
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+#define FIXED_TIMESTEP (1.0f / 60.0f)
+#define MAX_TIMESTEPS 6
 
 
 #ifdef _WINDOWS
@@ -33,27 +54,21 @@
 using namespace std;
 
 SDL_Window* displayWindow;
-
-GLuint loadTexture(const char* filePath) {
-	int w, h, comp;
-	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
-
-	if (image == NULL) {
-		cout << "Unable to load image. Make sure the path is correct\n";
-		assert(false);
-	}
-
-	GLuint retTexture;
-	glGenTextures(1, &retTexture);
-	glBindTexture(GL_TEXTURE_2D, retTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	stbi_image_free(image);
-	return retTexture;
-}
+SDL_GLContext glContext;
+TileMesh tileMesh;
+ShaderTileMap shaderTileMap;
+bool useShaderTiles = false;
+bool screenDirty = true;
+RenderQueue renderQueue;
+ResourceManager resources;
+ResolutionScaler resolutionScaler;
+bool useDynamicResolution = false;
+FrameCapture frameCapture;
+// per-frame state cache counters summed over the run, written by the render thread
+GLStateStats stateCacheTotals;
+TileProperties tileProperties;
+// what the levels share about platformer.png's tiles, loaded once at startup
+FlareMap tileset;
 
 void loadLevel(int**& mapData, int source[LEVEL_HEIGHT][LEVEL_WIDTH]) {
 	for (size_t i = 0; i < LEVEL_HEIGHT; i++) {
@@ -67,49 +82,25 @@ void loadLevel(int**& mapData, int source[LEVEL_HEIGHT][LEVEL_WIDTH]) {
 			}
 		}
 	}
+	renderQueue.SubmitLevel(mapData, LEVEL_WIDTH, LEVEL_HEIGHT, tileset.animations);
 }
 
-void drawText(ShaderProgram* program, int fontTexture, const string& text, float size, float spacing, float start_x, float start_y) {
-	float textureSize = 1 / 16.0f;
-	vector<float> vertexData;
-	vector<float> texData;
-	for (size_t i = 0; i < text.size(); i++) {
-		int spriteIndex = (int)text[i];
-		float texture_X = (float)(spriteIndex % 16) / 16.0f;
-		float texture_Y = (float)(spriteIndex / 16) / 16.0f;
-		vertexData.insert(vertexData.end(), {
-			((size + spacing) * i + (-0.5f * size)), 0.5f * size,
-			((size + spacing) * i + (-0.5f * size)), -0.5f * size,
-			((size + spacing) * i + (0.5f * size)), 0.5f * size,
-			((size + spacing) * i + (0.5f * size)), -0.5f * size,
-			((size + spacing) * i + (0.5f * size)), 0.5f * size,
-			((size + spacing) * i + (-0.5f * size)), -0.5f * size });
-		texData.insert(texData.end(), {
-			texture_X, texture_Y,
-			texture_X, texture_Y + textureSize,
-			texture_X + textureSize, texture_Y,
-			texture_X + textureSize, texture_Y + textureSize,
-			texture_X + textureSize, texture_Y,
-			texture_X, texture_Y + textureSize });
-	}
-	Matrix projectionMatrix;
-	Matrix modelMatrix;
-	Matrix viewMatrix;
-	projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
-	glUseProgram(program->programID);
-	glBindTexture(GL_TEXTURE_2D, fontTexture);
-	modelMatrix.Identity();
-	modelMatrix.Translate(start_x, start_y, 0.0f);
-	program->SetModelMatrix(modelMatrix);
-	program->SetProjectionMatrix(projectionMatrix);
-	program->SetViewMatrix(viewMatrix);
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
-	glDrawArrays(GL_TRIANGLES, 0, text.size() * 6);
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+unsigned char tileFlags(int tile) {
+	return tileProperties.flags[tile];
+}
+
+void setTile(int**& mapData, int gridY, int gridX, int value) {
+	mapData[gridY][gridX] = value;
+	renderQueue.SubmitTileChange(gridX, gridY, value);
+}
+
+// flat panel behind a prompt the player clicks; untextured, so it sorts under the text
+void drawPanel(RenderQueue& queue, float x, float y, float width, float height) {
+	queue.SubmitRect(LAYER_HUD, 0.0f, x, y, width, height, 0.2f, 0.3f, 0.6f, 0.6f);
+}
+
+void drawText(RenderQueue& queue, int fontTexture, const AtlasRegion& fontRegion, const string& text, float size, float spacing, float start_x, float start_y) {
+	queue.SubmitText(LAYER_HUD, fontTexture, fontRegion, text, size, spacing, start_x, start_y);
 }
 
 class Vector3 {
@@ -153,313 +144,210 @@ float lerp(float v0, float v1, float t) {
 	return (1.0f - t) * v0 + t * v1;
 }
 
+// boxes given by centre and size, touching edges count as overlapping
+bool boxesOverlap(float x1, float y1, float width1, float height1, float x2, float y2, float width2, float height2) {
+	if (x1 + 0.5f * width1 < x2 - 0.5f * width2 ||
+		x1 - 0.5f * width1 > x2 + 0.5f * width2 ||
+		y1 + 0.5f * height1 < y2 - 0.5f * height2 ||
+		y1 - 0.5f * height1 > y2 + 0.5f * height2) {
+		return false;
+	}
+	else {
+		return true;
+	}
+}
+
 enum EnemyState {IDLE, ALERT, FLEE};
 
+// also the tag on a bullet, where 0 marks one that nobody fired
+enum EntityKind { ENTITY_PLAYER = 1, ENTITY_ENEMY, ENTITY_BOARD };
+
 enum GameMode { STATE_MAIN_MENU, STATE_GUIDE_PAGE, STATE_LEVEL_ONE, STATE_LEVEL_TWO, STATE_LEVEL_THREE, STATE_GAME_OVER };
 
 class Entity {
 public:
 	Entity() {}
-	Entity(float x, float y, float z, float velocity_x, float velocity_y, float velocity_z, float accel_x, float accel_y, float accel_z, float size_x, float size_y, float size_z, const string& Type, const SheetSprite& mySprite) {
+	Entity(float x, float y, float z, float velocity_x, float velocity_y, float velocity_z, float accel_x, float accel_y, float accel_z, float size_x, float size_y, float size_z, EntityKind Kind, const SheetSprite& mySprite) {
 		position = Vector3(x, y, z);
 		velocity = Vector3(velocity_x, velocity_y, velocity_z);
 		acceleration = Vector3(accel_x, accel_y, accel_z);
 		size = Vector3(size_x, size_y, size_z);
-		type = Type;
+		previousPosition = position;
+		kind = Kind;
 		sprite = mySprite;
 	}
 
-	void draw(ShaderProgram* program, const Entity& player) {
-		Matrix modelMatrix;
-		Matrix projectionMatrix;
-		Matrix viewMatrix;
-		projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
-		glUseProgram(program->programID);
-		glBindTexture(GL_TEXTURE_2D, sprite.textureID);
-		modelMatrix.Identity();
-		modelMatrix.Translate(position.x, position.y, position.z);
-		viewMatrix.Identity();
-		viewMatrix.Translate(-player.position.x, -player.position.y, -player.position.z);
-		program->SetModelMatrix(modelMatrix);
-		program->SetProjectionMatrix(projectionMatrix);
-		program->SetViewMatrix(viewMatrix);
-		float vertices[] = { -0.5f * size.x, 0.5f * size.y, -0.5f * size.x, -0.5f * size.y, 0.5f * size.x, 0.5f * size.y,
-			0.5f * size.x, -0.5f * size.y, 0.5f * size.x, 0.5f * size.y, -0.5f * size.x, -0.5f * size.y };
-		glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-		glEnableVertexAttribArray(program->positionAttribute);
-		float texCoords[] = { sprite.u, sprite.v, sprite.u, sprite.v + sprite.height, sprite.u + sprite.width, sprite.v,
-			sprite.u + sprite.width, sprite.v + sprite.height, sprite.u + sprite.width, sprite.v, sprite.u, sprite.v + sprite.height };
-		glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
-		glEnableVertexAttribArray(program->texCoordAttribute);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program->positionAttribute);
-		glDisableVertexAttribArray(program->texCoordAttribute);
-	}
-
-	void sensePlayer(const Entity& player) {
-		int gridX, gridY, playerX, playerY;
-		worldToTile(position.x, position.y, &gridX, &gridY);
-		worldToTile(player.position.x, player.position.y, &playerX, &playerY);
-		float distance = float(fabs(gridX - playerX) + fabs(gridY - playerY));
-		if (distance < 15.0f && distance > 5.0f){
-			state = ALERT;
-		}
-		else if (distance <= 5.0f){
-			accumalator = 0.0f;
-			state = FLEE;
-			if (playerX >= gridX && velocity.x > 0.0f) {
-				velocity.x = -1.0f;
-			}
-			else if (playerX < gridX && velocity.x < 0.0f) {
-				velocity.x = 1.0f;
-			}
-		}
-		else {
-			accumalator = 0.0f;
-			state = IDLE;
-		}
+	// position between the last two simulation steps, alpha of the way to the latest one
+	Vector3 renderPosition(float alpha) const {
+		return Vector3(lerp(previousPosition.x, position.x, alpha), lerp(previousPosition.y, position.y, alpha), lerp(previousPosition.z, position.z, alpha));
 	}
 
-	void senseEdge(int**& mapData) {
-		vector<int> solidTiles = { 122, 332, 126, 127, 152, 395, 396, 397, 398, 252};
-		int gridLeftX, gridRightX, gridY;
-		worldToTile(position.x + 0.5f * size.x + 0.01f, position.y - 0.5f * size.y - 0.01f, &gridRightX, &gridY);
-		worldToTile(position.x - 0.5f * size.x - 0.01f, position.y - 0.5f * size.y - 0.01f, &gridLeftX, &gridY);
-		switch (state) {
-		case IDLE:
-		case ALERT:
-			if ((find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridLeftX]) == solidTiles.end()) && collideBot) {
-				velocity.x = -velocity.x;
-			}
-			else if ((find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridRightX]) == solidTiles.end()) && collideBot) {
-				velocity.x = -velocity.x;
-			}
-			break;
-		case FLEE:
-			if ((find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridLeftX]) == solidTiles.end()) && collideBot) {
-				velocity.y = 6.0f;
-				collideBot = false;
-			}
-			else if ((find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridRightX]) == solidTiles.end()) && collideBot) {
-				velocity.y = 6.0f;
-				collideBot = false;
-			}
-			break;
-		}
+	void draw(RenderQueue& queue, float alpha) {
+		Vector3 drawPosition = renderPosition(alpha);
+		queue.SubmitSprite(LAYER_WORLD, sprite.textureID, 0.0f, drawPosition.x, drawPosition.y, size.x, size.y, sprite.u, sprite.v, sprite.width, sprite.height);
 	}
 
-	Entity shoot(const SheetSprite& bulletSprite) {
+	// bullets are tagged with the shooter's kind
+	void shoot(EntityStore& bullets) {
 		if (velocity.x > 0) {
-			Entity bullet = Entity(position.x + 0.5f * TILE_SIZE, position.y, position.z, 1.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE, TILE_SIZE, 0.0f, "bullet", bulletSprite);
-			bullet.parent = this;
-			return bullet;
+			bullets.Add(position.x + 0.5f * TILE_SIZE, position.y, 1.5f, 0.0f, (unsigned char)kind);
 		}
 		else if (velocity.x < 0){
-			Entity bullet = Entity(position.x - 0.5f * TILE_SIZE, position.y, position.z, -1.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE, TILE_SIZE, 0.0f, "bullet", bulletSprite);
-			bullet.parent = this;
-			return bullet;
+			bullets.Add(position.x - 0.5f * TILE_SIZE, position.y, -1.5f, 0.0f, (unsigned char)kind);
 		}
 	}
 
-	void collideY(GameMode& mode, int**& mapData) {
-		vector<int> solidTiles = { 122, 332, 126, 127, 152, 395, 396, 397, 398, 252 };
+	// the tile probes and the board only ever stop the player, enemies collide in the store
+	void collidePlayerY(GameMode& mode, int**& mapData) {
 		int gridX, gridUpY, gridDownY;
 		worldToTile(position.x, position.y + 0.5f * size.y, &gridX, &gridUpY);
 		worldToTile(position.x, position.y - 0.5f * size.y, &gridX, &gridDownY);
-		if (find(solidTiles.begin(), solidTiles.end(), mapData[gridUpY][gridX]) != solidTiles.end()) {
+		unsigned char up = tileFlags(mapData[gridUpY][gridX]);
+		unsigned char down = tileFlags(mapData[gridDownY][gridX]);
+		if (up & TILE_SOLID) {
 			float penetration = position.y + 0.5f * size.y - (-TILE_SIZE * (gridUpY)-TILE_SIZE);
 			position.y -= (penetration + 0.001f);
 			velocity.y = 0.0f;
 		}
-		else if (find(solidTiles.begin(), solidTiles.end(), mapData[gridDownY][gridX]) != solidTiles.end()) {
+		else if (down & TILE_SOLID) {
 			float penetration = -TILE_SIZE * (gridDownY)-(position.y - 0.5f * size.y);
 			position.y += (penetration + 0.001f);
 			velocity.y = 0.0f;
 			collideBot = true;
 		}
-		else if (mapData[gridDownY][gridX] == 70) {
+		else if (down & TILE_LETHAL) {
 			float penetration = -TILE_SIZE * (gridDownY)-(position.y - 0.5f * size.y);
 			position.y += (penetration + 0.001f);
 			velocity.y = 0.0f;
 			alive = false;
 		}
-		else if (mapData[gridDownY][gridX] == 130) {
-			if (type == "player") {
-				mapData[gridDownY][gridX] = 360;
-				canShoot = true;
-			}
+		else if (down & TILE_PICKUP) {
+			setTile(mapData, gridDownY, gridX, 360);
+			canShoot = true;
 		}
-		else if (mapData[gridDownY][gridX] == 284) {
-			if (type == "player") {
-				velocity.y = 9.0f;
-			}
+		else if (down & TILE_SPRING) {
+			velocity.y = 9.0f;
 		}
-		else if (mapData[gridDownY][gridX] == 14) {
-			if (type == "player") {
-				switch (mode) {
-				case STATE_LEVEL_TWO:
-					mapData[gridDownY][gridX] = 360;
-					mapData[27][62] = 360;
-					break;
-				case STATE_LEVEL_THREE:
-					mapData[gridDownY][gridX] = 360;
-					mapData[5][60] = 360;
-					break;
-				}
+		else if (down & TILE_DOOR) {
+			switch (mode) {
+			case STATE_LEVEL_TWO:
+				setTile(mapData, gridDownY, gridX, 360);
+				setTile(mapData, 27, 62, 360);
+				break;
+			case STATE_LEVEL_THREE:
+				setTile(mapData, gridDownY, gridX, 360);
+				setTile(mapData, 5, 60, 360);
+				break;
 			}
 		}
-		else if (mapData[gridDownY][gridX] == 310) {
-			if (type == "player") {
-				exit = true;
-			}
+		else if (down & TILE_EXIT) {
+			exit = true;
 		}
 	}
 
-	void collideX(GameMode& mode, int**& mapData) {
-		vector<int> solidTiles = { 122, 332, 126, 127, 152, 395, 396, 397, 398, 252, 284};
+	void collidePlayerX(GameMode& mode, int**& mapData) {
 		int gridLeftX, gridRightX, gridY;
 		worldToTile(position.x - 0.5f * size.x, position.y, &gridLeftX, &gridY);
 		worldToTile(position.x + 0.5f * size.x, position.y, &gridRightX, &gridY);
-		if (find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridLeftX]) != solidTiles.end()) {
+		unsigned char left = tileFlags(mapData[gridY][gridLeftX]);
+		unsigned char right = tileFlags(mapData[gridY][gridRightX]);
+		if (left & (TILE_SOLID | TILE_WALL)) {
 			float penetration = TILE_SIZE * (gridLeftX)+TILE_SIZE - (position.x - 0.5f * size.x);
 			position.x += (penetration + 0.001f);
-			if (type == "enemy") {
-				velocity.x = -velocity.x;
-			}
-			else if (type == "bullet") {
-				collideSide = true;
-			}
-			else if (type == "player") {
-				velocity.x = 0.0f;
-			}
+			velocity.x = 0.0f;
 		}
-		else if (find(solidTiles.begin(), solidTiles.end(), mapData[gridY][gridRightX]) != solidTiles.end()) {
+		else if (right & (TILE_SOLID | TILE_WALL)) {
 			float penetration = position.x + 0.5f * size.x - TILE_SIZE * (gridRightX);
 			position.x -= (penetration + 0.001f);
-			if (type == "enemy") {
-				velocity.x = -velocity.x;
-			}
-			else if (type == "bullet") {
-				collideSide = true;
-			}
-			else if (type == "player") {
-				velocity.x = 0.0f;
-			}
+			velocity.x = 0.0f;
 		}
-		else if (mapData[gridY][gridLeftX] == 70 || mapData[gridY][gridRightX] == 70) {
-			if (type == "player") {
-				alive = false;
-			}
-			else if (type == "enemy") {
-				if (mapData[gridY][gridLeftX] == 70) {
-					float penetration = TILE_SIZE * (gridLeftX)+TILE_SIZE - (position.x - 0.5f * size.x);
-					position.x += (penetration + 0.001f);
-					velocity.x = -velocity.x;
-				}
-				else {
-					float penetration = position.x + 0.5f * size.x - TILE_SIZE * (gridRightX);
-					position.x -= (penetration + 0.001f);
-					velocity.x = -velocity.x;
-				}
-			}
+		else if ((left | right) & TILE_LETHAL) {
+			alive = false;
 		}
-		else if (mapData[gridY][gridLeftX] == 130) {
-			if (type == "player") {
-				mapData[gridY][gridLeftX] = 360;
-				canShoot = true;
-			}
+		else if (left & TILE_PICKUP) {
+			setTile(mapData, gridY, gridLeftX, 360);
+			canShoot = true;
 		}
-		else if (mapData[gridY][gridRightX] == 130) {
-			if (type == "player") {
-				mapData[gridY][gridRightX] = 360;
-				canShoot = true;
-			}
+		else if (right & TILE_PICKUP) {
+			setTile(mapData, gridY, gridRightX, 360);
+			canShoot = true;
 		}
-		else if (mapData[gridY][gridLeftX] == 310 || mapData[gridY][gridRightX] == 310){
+		else if ((left | right) & TILE_EXIT) {
 			exit = true;
 		}
-		else if (mapData[gridY][gridLeftX] == 14 || mapData[gridY][gridRightX] == 14){
-			if (type == "player") {
-				switch (mode) {
-				case STATE_LEVEL_TWO:
-					mapData[gridY][gridRightX] = 360;
-					mapData[gridY][gridRightX + 1] = 360;
-					mapData[27][62] = 360;
-					break;
-				case STATE_LEVEL_THREE:
-					mapData[gridY][gridLeftX] = 360;
-					mapData[5][60] = 360;
-					break;
-				}
+		else if ((left | right) & TILE_DOOR) {
+			switch (mode) {
+			case STATE_LEVEL_TWO:
+				setTile(mapData, gridY, gridRightX, 360);
+				setTile(mapData, gridY, gridRightX + 1, 360);
+				setTile(mapData, 27, 62, 360);
+				break;
+			case STATE_LEVEL_THREE:
+				setTile(mapData, gridY, gridLeftX, 360);
+				setTile(mapData, 5, 60, 360);
+				break;
 			}
 		}
 	}
 
 	void standOnBoard(const Entity& board) {
-		if (type == "player" || type == "enemy") {
-			if (position.x + 0.5f * size.x < board.position.x - 0.5f * board.size.x || position.x - 0.5f * size.x > board.position.x + 0.5f * board.size.x ||
-				position.y - 0.5f * size.y > board.position.y + 0.5f * board.size.y || position.y + 0.5f * size.y < board.position.y - 0.5f * board.size.y) {
-				onBoard = false;
+		if (position.x + 0.5f * size.x < board.position.x - 0.5f * board.size.x || position.x - 0.5f * size.x > board.position.x + 0.5f * board.size.x ||
+			position.y - 0.5f * size.y > board.position.y + 0.5f * board.size.y || position.y + 0.5f * size.y < board.position.y - 0.5f * board.size.y) {
+			onBoard = false;
+		}
+		else{
+			if (position.y - 0.5f * size.y > board.position.y - 0.5f * board.size.y) {
+				float penetration = board.position.y + 0.5f * board.size.y - (position.y - 0.5f * size.y);
+				position.y += (penetration + 0.001f);
+				velocity.y = 0.0f;
+				collideBot = true;
+				onBoard = true;
 			}
-			else{
-				if (position.y - 0.5f * size.y > board.position.y - 0.5f * board.size.y) {
-					float penetration = board.position.y + 0.5f * board.size.y - (position.y - 0.5f * size.y);
-					position.y += (penetration + 0.001f);
-					velocity.y = 0.0f;
-					collideBot = true;
-					onBoard = true;
-				}
-				else {
-					float penetration = position.y + 0.5f * size.y - (board.position.y - 0.5f * board.size.y);
-					position.y -= (penetration + 0.001f);
-					velocity.y = 0.0f;
-					onBoard = false;
-				}
+			else {
+				float penetration = position.y + 0.5f * size.y - (board.position.y - 0.5f * board.size.y);
+				position.y -= (penetration + 0.001f);
+				velocity.y = 0.0f;
+				onBoard = false;
 			}
 		}
 	}
 
+	void updatePlayer(GameMode& mode, float& elapsed, int**& mapData, const Entity& board) {
+		if (onBoard) {
+			velocity.x = board.velocity.x;
+			velocity.x += float(acceleration.x / 2.0f);
+		}
+		else {
+			velocity.x = lerp(velocity.x, 0.0f, elapsed * FRICTION_X);
+			velocity.x += acceleration.x * elapsed;
+		}
+		velocity.y = lerp(velocity.y, 0.0f, elapsed * FRICTION_Y);
+		velocity.y += (acceleration.y - GRAVITY) * elapsed;
+		position.y += elapsed * velocity.y;
+		standOnBoard(board);
+		collidePlayerY(mode, mapData);
+		position.x += elapsed * velocity.x;
+		collidePlayerX(mode, mapData);
+	}
+
+	void updateBoard(float& elapsed) {
+		position.x += elapsed * velocity.x;
+		if (position.x > 53 * TILE_SIZE + 0.5f * TILE_SIZE) {
+			velocity.x = -2.0f;
+		}
+		else if (position.x < 7 * TILE_SIZE + 0.5f * TILE_SIZE) {
+			velocity.x = 2.0f;
+		}
+	}
+
 	void update(GameMode& mode, float& elapsed, int**& mapData, const Entity& player, const Entity& board) {
-		if (type == "player") {
-			if (onBoard) {
-				velocity.x = board.velocity.x;
-				velocity.x += float(acceleration.x / 2.0f);
-			}
-			else {
-				velocity.x = lerp(velocity.x, 0.0f, elapsed * FRICTION_X);
-				velocity.x += acceleration.x * elapsed;
-			}
-			velocity.y = lerp(velocity.y, 0.0f, elapsed * FRICTION_Y);
-			velocity.y += (acceleration.y - GRAVITY) * elapsed;
-			position.y += elapsed * velocity.y;
-			standOnBoard(board);
-			collideY(mode, mapData);
-			position.x += elapsed * velocity.x;
-			collideX(mode, mapData);
-		}
-		else if (type == "enemy") {
-			accumalator += elapsed;
-			velocity.y = lerp(velocity.y, 0.0f, elapsed * FRICTION_Y);
-			velocity.y += (acceleration.y - GRAVITY) * elapsed;
-			position.y += elapsed * velocity.y;
-			collideY(mode, mapData);
-			position.x += elapsed * velocity.x;
-			collideX(mode, mapData);
-			sensePlayer(player);
-			senseEdge(mapData);
-		}
-		else if (type == "bullet") {
-			position.x += elapsed * velocity.x;
-			collideX(mode, mapData);
-		}
-		else if (type == "board") {
-			position.x += elapsed * velocity.x;
-			if (position.x > 53 * TILE_SIZE + 0.5f * TILE_SIZE) {
-				velocity.x = -2.0f;
-			}
-			else if (position.x < 7 * TILE_SIZE + 0.5f * TILE_SIZE) {
-				velocity.x = 2.0f;
-			}
+		switch (kind) {
+		case ENTITY_PLAYER:
+			updatePlayer(mode, elapsed, mapData, board);
+			break;
+		case ENTITY_BOARD:
+			updateBoard(elapsed);
+			break;
 		}
 	}
 
@@ -467,13 +355,13 @@ public:
 		int gridX, gridDownY, gridLeftX, gridY;
 		worldToTile(position.x, position.y - 0.5f * size.y, &gridX, &gridDownY);
 		worldToTile(position.x - 0.5f * size.x, position.y, &gridLeftX, &gridY);
-		if (mapData[gridY][gridLeftX] == 250) {
+		if (tileFlags(mapData[gridY][gridLeftX]) & TILE_SWITCH) {
 			float penetration = (TILE_SIZE * (gridLeftX)+TILE_SIZE) - (position.x - 0.5f * size.x);
 			position.x += (penetration + 0.001f);
 			velocity.x = 0.0f;
 			return true;
 		}
-		else if (mapData[gridDownY][gridX] == 250) {
+		else if (tileFlags(mapData[gridDownY][gridX]) & TILE_SWITCH) {
 			float penetration = -TILE_SIZE * (gridDownY)-(position.y - 0.5f * size.y);
 			position.y += (penetration + 0.001f);
 			velocity.y = 0.0f;
@@ -482,122 +370,45 @@ public:
 		return false;
 	}
 
-	bool collide(Entity& other) {
-		if (position.x + 0.5f * size.x < other.position.x - 0.5f * other.size.x ||
-			position.x - 0.5f * size.x > other.position.x + 0.5f * other.size.x ||
-			position.y + 0.5f * size.y < other.position.y - 0.5f * other.size.y ||
-			position.y - 0.5f * size.y > other.position.y + 0.5f * other.size.y) {
-			return false;
-		}
-		else {
-			return true;
-		}
+	bool collideBox(float x, float y, float width, float height) const {
+		return boxesOverlap(position.x, position.y, size.x, size.y, x, y, width, height);
 	}
 
 	Vector3 position;
+	Vector3 previousPosition;
 	Vector3 velocity;
 	Vector3 acceleration;
 	Vector3 size;
-	Entity* parent = nullptr;
 	SheetSprite sprite;
-	string type;
+	EntityKind kind;
 	bool collideBot = false;
-	bool collideSide = false;
 	bool alive = true;
 	bool canShoot = false;
 	bool onBoard = false;
 	bool exit = false;
-	EnemyState state = IDLE;
-	float accumalator = 0.0f;
 };
 
-void drawTile(ShaderProgram* program, int textureID, const FlareMap& map, const Entity& player, int**& mapData) {
-	vector<float> vertexData;
-	vector<float> texCoordData;
-	int counter = 0;
-	for (size_t y = 0; y < LEVEL_HEIGHT; y++) {
-		for (size_t x = 0; x < LEVEL_WIDTH; x++) {
-			if (mapData[y][x] != 0) {
-				counter += 1;
-				float u = (float)(((int)mapData[y][x] % SPRITE_COUNT_X) / (float)SPRITE_COUNT_X);
-				float v = (float)(((int)mapData[y][x] / SPRITE_COUNT_X) / (float)SPRITE_COUNT_Y);
-				float spriteWidth = 1.0f / SPRITE_COUNT_X;
-				float spriteHeight = 1.0f / SPRITE_COUNT_Y;
-				vertexData.insert(vertexData.end(), {
-					TILE_SIZE * x, -TILE_SIZE * y,
-					TILE_SIZE * x, -TILE_SIZE * y - TILE_SIZE,
-					TILE_SIZE * x + TILE_SIZE, -TILE_SIZE * y - TILE_SIZE,
-					TILE_SIZE * x, -TILE_SIZE * y,
-					TILE_SIZE * x + TILE_SIZE, -TILE_SIZE * y - TILE_SIZE,
-					TILE_SIZE * x + TILE_SIZE, -TILE_SIZE * y });
-				texCoordData.insert(texCoordData.end(), {
-					u, v,
-					u, v + spriteHeight,
-					u + spriteWidth, v + spriteHeight,
-					u, v,
-					u + spriteWidth, v + spriteHeight,
-					u + spriteWidth, v });
-			}
-		}
+void drawTile(RenderQueue& queue, int textureID, const FlareMap& map, const Vector3& center, int**& mapData) {
+	float left = center.x - 3.55f;
+	float right = center.x + 3.55f;
+	float bottom = center.y - 2.0f;
+	float top = center.y + 2.0f;
+	if (useShaderTiles) {
+		queue.SubmitShaderTiles(LAYER_TILES, textureID, &shaderTileMap, left, right, bottom, top);
+	}
+	else {
+		queue.SubmitTiles(LAYER_TILES, textureID, &tileMesh, left, right, bottom, top);
 	}
-	Matrix projectionMatrix;
-	Matrix modelMatrix;
-	Matrix viewMatrix;
-	projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
-	glUseProgram(program->programID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	viewMatrix.Identity();
-	viewMatrix.Translate(-player.position.x, -player.position.y, -player.position.z);
-	program->SetModelMatrix(modelMatrix);
-	program->SetProjectionMatrix(projectionMatrix);
-	program->SetViewMatrix(viewMatrix);
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoordData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
-	glDrawArrays(GL_TRIANGLES, 0, counter * 6);
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
 }
 
-void drawMovement(ShaderProgram* program, int textureID, const Entity& player, int index, int spriteCountX, int spriteCountY) {
-	float u = (float)(((int)index) % spriteCountX) / (float)spriteCountX;
-	float v = (float)(((int)index) / spriteCountX) / (float)spriteCountY;
-	float spriteWidth = 1.0f / (float)spriteCountX;
-	float spriteHeight = 1.0f / (float)spriteCountY;
-	float texCoords[] = {
-		u, v + spriteHeight,
-		u + spriteWidth, v,
-		u, v,
-		u + spriteWidth, v,
-		u, v + spriteHeight,
-		u + spriteWidth, v + spriteHeight
-	};
-	float vertices[] = { -0.5f * player.size.x, -0.5f * player.size.y, 0.5f * player.size.x, 0.5f * player.size.y, -0.5f * player.size.x, 0.5f * player.size.y,
-						 0.5f * player.size.x, 0.5f * player.size.y, -0.5f * player.size.x, -0.5f * player.size.y, 0.5f * player.size.x, -0.5f * player.size.y };
-	Matrix projectionMatrix;
-	Matrix modelMatrix;
-	Matrix viewMatrix;
-	projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
-	glUseProgram(program->programID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	modelMatrix.Identity();
-	modelMatrix.Translate(player.position.x, player.position.y, player.position.z);
-	viewMatrix.Identity();
-	viewMatrix.Translate(-player.position.x, -player.position.y, -player.position.z);
-	program->SetModelMatrix(modelMatrix);
-	program->SetProjectionMatrix(projectionMatrix);
-	program->SetViewMatrix(viewMatrix);
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
-	glEnableVertexAttribArray(program->texCoordAttribute);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+void drawMovement(RenderQueue& queue, int textureID, const AtlasRegion& sheetRegion, const Entity& player, int index, int spriteCountX, int spriteCountY, float alpha) {
+	float u, v, spriteWidth, spriteHeight;
+	sheetRegion.MapCell(index, spriteCountX, spriteCountY, u, v, spriteWidth, spriteHeight);
+	Vector3 drawPosition = player.renderPosition(alpha);
+	queue.SubmitSprite(LAYER_WORLD, textureID, 0.0f, drawPosition.x, drawPosition.y, player.size.x, player.size.y, u, v, spriteWidth, spriteHeight);
 }
 
-void renderPlayer(ShaderProgram* program, int textureID, const Entity& player, const int* animation, const int numFrames, float& animationElapsed, float framesPerSecond, float& elapsed, int& currentIndex) {
+void renderPlayer(RenderQueue& queue, int textureID, const AtlasRegion& sheetRegion, const Entity& player, const int* animation, const int numFrames, float& animationElapsed, float framesPerSecond, float& elapsed, int& currentIndex, float alpha) {
 	animationElapsed += elapsed;
 	if (animationElapsed > 1.0 / framesPerSecond) {
 		currentIndex++;
@@ -606,48 +417,380 @@ void renderPlayer(ShaderProgram* program, int textureID, const Entity& player, c
 			currentIndex = 0;
 		}
 	}
-	drawMovement(program, textureID, player, animation[currentIndex], 7, 3);
+	drawMovement(queue, textureID, sheetRegion, player, animation[currentIndex], 7, 3, alpha);
 }
 
 class GameState {
 public:
 	GameState() {}
 	Entity player;
-	vector<Entity> enemies;
-	vector<Entity> bullets;
+	// enemies and bullets come in numbers, so they live in arrays rather than Entity records
+	EntityStore enemies;
+	EntityStore bullets;
+	SheetSprite enemySprite;
+	SheetSprite bulletSprite;
 	Entity board;
+	CollisionGrid enemyGrid;
+	vector<int> nearbyEnemies;
+
+	// called before every simulation step so rendering can blend from these
+	void savePositions() {
+		player.previousPosition = player.position;
+		board.previousPosition = board.position;
+		enemies.SavePositions();
+		bullets.SavePositions();
+	}
+
+	// enemy ids by grid cell, so each bullet only tests the enemies around it
+	void bucketEnemies() {
+		enemyGrid.Clear();
+		for (int i = 0; i < enemies.Count(); i++) {
+			enemyGrid.Insert(i, enemies.x[i], enemies.y[i]);
+		}
+	}
 };
 
-void placeEntity(GameState& state, const string& type, float x, float y, const SheetSprite& mySprite) {
-	state.enemies.push_back(Entity(x * TILE_SIZE + 0.5f * TILE_SIZE, -y * TILE_SIZE - 0.5f * TILE_SIZE, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE, TILE_SIZE, 0.0f, type, mySprite));
+// every object the levels place is an enemy
+void placeEntity(GameState& state, float x, float y) {
+	int enemy = state.enemies.Add(x * TILE_SIZE + 0.5f * TILE_SIZE, -y * TILE_SIZE - 0.5f * TILE_SIZE, 1.0f, 0.0f, ENTITY_ENEMY);
+	state.enemies.behavior[enemy] = IDLE;
+}
+
+// counts bullet and enemy pairs that overlap but that the grid query around the bullet
+// never offered, by checking every pair the O(bullets * enemies) way
+int checkEnemyGrid(GameState& state) {
+	int misses = 0;
+	for (int i = 0; i < state.bullets.Count(); i++) {
+		state.enemyGrid.Query(state.bullets.x[i], state.bullets.y[i], state.nearbyEnemies);
+		for (int j = 0; j < state.enemies.Count(); j++) {
+			if (boxesOverlap(state.enemies.x[j], state.enemies.y[j], TILE_SIZE, TILE_SIZE, state.bullets.x[i], state.bullets.y[i], TILE_SIZE, TILE_SIZE) &&
+				find(state.nearbyEnemies.begin(), state.nearbyEnemies.end(), j) == state.nearbyEnemies.end()) {
+				misses++;
+			}
+		}
+	}
+	return misses;
+}
+
+// parks count untagged, motionless bullets round-robin over the open tiles, so the bullet
+// update can be timed at a known load; they hurt nobody and nothing clears them
+void spawnStressBullets(GameState& state, int**& mapData, int count) {
+	vector<int> openTiles;
+	for (int y = 0; y < LEVEL_HEIGHT; y++) {
+		for (int x = 1; x < LEVEL_WIDTH - 1; x++) {
+			if (!tileFlags(mapData[y][x - 1]) && !tileFlags(mapData[y][x]) && !tileFlags(mapData[y][x + 1])) {
+				openTiles.push_back(y * LEVEL_WIDTH + x);
+			}
+		}
+	}
+	for (int i = 0; i < count && !openTiles.empty(); i++) {
+		int tile = openTiles[i % openTiles.size()];
+		state.bullets.Add((tile % LEVEL_WIDTH) * TILE_SIZE + 0.5f * TILE_SIZE, -(tile / LEVEL_WIDTH) * TILE_SIZE - 0.5f * TILE_SIZE, 0.0f, 0.0f, 0);
+	}
+}
+
+// bullets are TILE_SIZE squares that stop at the first solid or wall tile beside them
+void collideBullets(EntityStore& bullets, int**& mapData) {
+	int count = bullets.Count();
+	for (int i = 0; i < count; i++) {
+		int gridLeftX, gridRightX, gridY;
+		worldToTile(bullets.x[i] - 0.5f * TILE_SIZE, bullets.y[i], &gridLeftX, &gridY);
+		worldToTile(bullets.x[i] + 0.5f * TILE_SIZE, bullets.y[i], &gridRightX, &gridY);
+		if (tileFlags(mapData[gridY][gridLeftX]) & (TILE_SOLID | TILE_WALL)) {
+			float penetration = TILE_SIZE * (gridLeftX)+TILE_SIZE - (bullets.x[i] - 0.5f * TILE_SIZE);
+			bullets.x[i] += (penetration + 0.001f);
+			bullets.removed[i] = 1;
+		}
+		else if (tileFlags(mapData[gridY][gridRightX]) & (TILE_SOLID | TILE_WALL)) {
+			float penetration = bullets.x[i] + 0.5f * TILE_SIZE - TILE_SIZE * (gridRightX);
+			bullets.x[i] -= (penetration + 0.001f);
+			bullets.removed[i] = 1;
+		}
+	}
+}
+
+// Enemies are TILE_SIZE boxes. Their vertical and horizontal moves run as batched kernels
+// over the whole store; tile collision and sensing below stay per enemy, between them.
+void collideEnemyY(EntityStore& enemies, int i, int**& mapData) {
+	int gridX, gridUpY, gridDownY;
+	worldToTile(enemies.x[i], enemies.y[i] + 0.5f * TILE_SIZE, &gridX, &gridUpY);
+	worldToTile(enemies.x[i], enemies.y[i] - 0.5f * TILE_SIZE, &gridX, &gridDownY);
+	unsigned char up = tileFlags(mapData[gridUpY][gridX]);
+	unsigned char down = tileFlags(mapData[gridDownY][gridX]);
+	if (up & TILE_SOLID) {
+		float penetration = enemies.y[i] + 0.5f * TILE_SIZE - (-TILE_SIZE * (gridUpY)-TILE_SIZE);
+		enemies.y[i] -= (penetration + 0.001f);
+		enemies.velocityY[i] = 0.0f;
+	}
+	else if (down & TILE_SOLID) {
+		float penetration = -TILE_SIZE * (gridDownY)-(enemies.y[i] - 0.5f * TILE_SIZE);
+		enemies.y[i] += (penetration + 0.001f);
+		enemies.velocityY[i] = 0.0f;
+		enemies.grounded[i] = 1;
+	}
+	else if (down & TILE_LETHAL) {
+		float penetration = -TILE_SIZE * (gridDownY)-(enemies.y[i] - 0.5f * TILE_SIZE);
+		enemies.y[i] += (penetration + 0.001f);
+		enemies.velocityY[i] = 0.0f;
+		enemies.removed[i] = 1;
+	}
+}
+
+void collideEnemyX(EntityStore& enemies, int i, int**& mapData) {
+	int gridLeftX, gridRightX, gridY;
+	worldToTile(enemies.x[i] - 0.5f * TILE_SIZE, enemies.y[i], &gridLeftX, &gridY);
+	worldToTile(enemies.x[i] + 0.5f * TILE_SIZE, enemies.y[i], &gridRightX, &gridY);
+	unsigned char left = tileFlags(mapData[gridY][gridLeftX]);
+	unsigned char right = tileFlags(mapData[gridY][gridRightX]);
+	if (left & (TILE_SOLID | TILE_WALL)) {
+		float penetration = TILE_SIZE * (gridLeftX)+TILE_SIZE - (enemies.x[i] - 0.5f * TILE_SIZE);
+		enemies.x[i] += (penetration + 0.001f);
+		enemies.velocityX[i] = -enemies.velocityX[i];
+	}
+	else if (right & (TILE_SOLID | TILE_WALL)) {
+		float penetration = enemies.x[i] + 0.5f * TILE_SIZE - TILE_SIZE * (gridRightX);
+		enemies.x[i] -= (penetration + 0.001f);
+		enemies.velocityX[i] = -enemies.velocityX[i];
+	}
+	else if (left & TILE_LETHAL) {
+		float penetration = TILE_SIZE * (gridLeftX)+TILE_SIZE - (enemies.x[i] - 0.5f * TILE_SIZE);
+		enemies.x[i] += (penetration + 0.001f);
+		enemies.velocityX[i] = -enemies.velocityX[i];
+	}
+	else if (right & TILE_LETHAL) {
+		float penetration = enemies.x[i] + 0.5f * TILE_SIZE - TILE_SIZE * (gridRightX);
+		enemies.x[i] -= (penetration + 0.001f);
+		enemies.velocityX[i] = -enemies.velocityX[i];
+	}
+}
+
+void senseEnemyPlayer(EntityStore& enemies, int i, const Entity& player) {
+	int gridX, gridY, playerX, playerY;
+	worldToTile(enemies.x[i], enemies.y[i], &gridX, &gridY);
+	worldToTile(player.position.x, player.position.y, &playerX, &playerY);
+	float distance = float(fabs(gridX - playerX) + fabs(gridY - playerY));
+	if (distance < 15.0f && distance > 5.0f){
+		enemies.behavior[i] = ALERT;
+	}
+	else if (distance <= 5.0f){
+		enemies.timer[i] = 0.0f;
+		enemies.behavior[i] = FLEE;
+		if (playerX >= gridX && enemies.velocityX[i] > 0.0f) {
+			enemies.velocityX[i] = -1.0f;
+		}
+		else if (playerX < gridX && enemies.velocityX[i] < 0.0f) {
+			enemies.velocityX[i] = 1.0f;
+		}
+	}
+	else {
+		enemies.timer[i] = 0.0f;
+		enemies.behavior[i] = IDLE;
+	}
+}
+
+void senseEnemyEdge(EntityStore& enemies, int i, int**& mapData) {
+	int gridLeftX, gridRightX, gridY;
+	worldToTile(enemies.x[i] + 0.5f * TILE_SIZE + 0.01f, enemies.y[i] - 0.5f * TILE_SIZE - 0.01f, &gridRightX, &gridY);
+	worldToTile(enemies.x[i] - 0.5f * TILE_SIZE - 0.01f, enemies.y[i] - 0.5f * TILE_SIZE - 0.01f, &gridLeftX, &gridY);
+	if (!enemies.grounded[i]) {
+		return;
+	}
+	bool edge = !(tileFlags(mapData[gridY][gridLeftX]) & TILE_SOLID) || !(tileFlags(mapData[gridY][gridRightX]) & TILE_SOLID);
+	if (!edge) {
+		return;
+	}
+	if (enemies.behavior[i] == FLEE) {
+		enemies.velocityY[i] = 6.0f;
+		enemies.grounded[i] = 0;
+	}
+	else {
+		enemies.velocityX[i] = -enemies.velocityX[i];
+	}
 }
 
-bool shouldRemove(const Entity& bullet) {
-	return bullet.collideSide;
+void enemyShoot(EntityStore& enemies, int i, EntityStore& bullets) {
+	if (enemies.velocityX[i] > 0) {
+		bullets.Add(enemies.x[i] + 0.5f * TILE_SIZE, enemies.y[i], 1.5f, 0.0f, ENTITY_ENEMY);
+	}
+	else if (enemies.velocityX[i] < 0){
+		bullets.Add(enemies.x[i] - 0.5f * TILE_SIZE, enemies.y[i], -1.5f, 0.0f, ENTITY_ENEMY);
+	}
+}
+
+void updateEnemies(GameState& state, float elapsed, int**& mapData) {
+	EntityStore& enemies = state.enemies;
+	enemies.AdvanceTimers(elapsed);
+	enemies.ApplyGravity(elapsed, FRICTION_Y, GRAVITY);
+	enemies.IntegrateY(elapsed);
+	for (int i = 0; i < enemies.Count(); i++) {
+		collideEnemyY(enemies, i, mapData);
+	}
+	enemies.IntegrateX(elapsed);
+	for (int i = 0; i < enemies.Count(); i++) {
+		collideEnemyX(enemies, i, mapData);
+		senseEnemyPlayer(enemies, i, state.player);
+		senseEnemyEdge(enemies, i, mapData);
+	}
 }
 
-bool shouldDie(const Entity& enemy) {
-	return !enemy.alive;
+// bullets against the player, then the player's bullets against the enemies near them in the grid;
+// true when an enemy bullet hit the player, which leaves the bullets for the caller to clear
+bool updateBullets(GameState& state, float elapsed, int**& mapData) {
+	EntityStore& bullets = state.bullets;
+	bullets.Compact();
+	state.bucketEnemies();
+	for (int i = 0; i < bullets.Count(); i++) {
+		if (bullets.tag[i] == ENTITY_ENEMY && state.player.collideBox(bullets.x[i], bullets.y[i], TILE_SIZE, TILE_SIZE)) {
+			return true;
+		}
+		if (bullets.tag[i] == ENTITY_PLAYER) {
+			state.enemyGrid.Query(bullets.x[i], bullets.y[i], state.nearbyEnemies);
+			for (size_t j = 0; j < state.nearbyEnemies.size(); j++) {
+				int enemy = state.nearbyEnemies[j];
+				if (boxesOverlap(state.enemies.x[enemy], state.enemies.y[enemy], TILE_SIZE, TILE_SIZE, bullets.x[i], bullets.y[i], TILE_SIZE, TILE_SIZE)) {
+					bullets.removed[i] = 1;
+					state.enemies.removed[enemy] = 1;
+				}
+			}
+		}
+	}
+	bullets.Integrate(elapsed);
+	collideBullets(bullets, mapData);
+	return false;
 }
 
-void setUp() {
+struct LaunchOptions {
+	bool headless = false;
+	bool play = false;
+	bool checkGrid = false;
+	int frames = 300;
+	int stressBullets = 0;
+	// average sprite and instance draw calls a frame may take before the run fails; 0 is no limit
+	float maxDrawCalls = 0.0f;
+	// kilobytes of texture memory the run may load before it fails; 0 is no budget
+	int textureBudget = 0;
+	const char* dumpFolder = nullptr;
+	bool shaderTiles = false;
+	bool greedy = true;
+	bool dynamicResolution = false;
+	// milliseconds; 0 keeps the scaler's default
+	float frameBudget = 0.0f;
+	const char* capturePath = nullptr;
+};
+
+// --headless [--frames N] [--dump FOLDER] [--play [--stress-bullets N]] [--check-grid]
+//   [--max-draw-calls N] [--texture-budget KB]
+// --shader-tiles --no-greedy --dynamic-resolution --frame-budget MS --capture PATH
+LaunchOptions parseLaunchOptions(int argc, char* argv[]) {
+	LaunchOptions options;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--headless") {
+			options.headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			options.frames = atoi(argv[++i]);
+		}
+		else if (arg == "--dump" && i + 1 < argc) {
+			options.dumpFolder = argv[++i];
+		}
+		else if (arg == "--play") {
+			options.play = true;
+		}
+		else if (arg == "--stress-bullets" && i + 1 < argc) {
+			options.stressBullets = atoi(argv[++i]);
+		}
+		else if (arg == "--check-grid") {
+			options.checkGrid = true;
+		}
+		else if (arg == "--max-draw-calls" && i + 1 < argc) {
+			options.maxDrawCalls = (float)atof(argv[++i]);
+		}
+		else if (arg == "--texture-budget" && i + 1 < argc) {
+			options.textureBudget = atoi(argv[++i]);
+		}
+		else if (arg == "--shader-tiles") {
+			options.shaderTiles = true;
+		}
+		else if (arg == "--no-greedy") {
+			options.greedy = false;
+		}
+		else if (arg == "--dynamic-resolution") {
+			options.dynamicResolution = true;
+		}
+		else if (arg == "--frame-budget" && i + 1 < argc) {
+			options.frameBudget = (float)atof(argv[++i]);
+			options.dynamicResolution = true;
+		}
+		else if (arg == "--capture" && i + 1 < argc) {
+			// a .y4m path records one raw video stream, anything else is a folder for PNG frames
+			options.capturePath = argv[++i];
+		}
+	}
+	return options;
+}
+
+void setUp(const LaunchOptions& options) {
+	Uint32 windowFlags = SDL_WINDOW_OPENGL;
+	if (options.headless) {
+		// no display or GPU: SDL's offscreen driver gives an EGL context, Mesa picks llvmpipe
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+		SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+		windowFlags |= SDL_WINDOW_HIDDEN;
+	}
 	SDL_Init(SDL_INIT_VIDEO);
-	displayWindow = SDL_CreateWindow("My World", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_OPENGL);
-	SDL_GLContext context = SDL_GL_CreateContext(displayWindow);
-	SDL_GL_MakeCurrent(displayWindow, context);
+	displayWindow = SDL_CreateWindow("My World", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, windowFlags);
+	glContext = SDL_GL_CreateContext(displayWindow);
+	SDL_GL_MakeCurrent(displayWindow, glContext);
 	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
 #ifdef _WINDOWS
 	glewInit();
 #endif
-	glViewport(0, 0, 1280, 720);
+	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
-void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& event, bool& done, Mix_Chunk* jumpSound,const SheetSprite& playerSprite, const SheetSprite& enemySprite, const SheetSprite& bulletSprite, int levelOne[LEVEL_HEIGHT][LEVEL_WIDTH], int**& mapData) {
+bool isStaticScreen(GameMode mode) {
+	return mode == STATE_MAIN_MENU || mode == STATE_GUIDE_PAGE || mode == STATE_GAME_OVER;
+}
+
+// SDL_PollEvent that also notes window events, after which a static screen must be presented again
+bool pollEvent(SDL_Event& event) {
+	if (!SDL_PollEvent(&event)) {
+		return false;
+	}
+	if (event.type == SDL_WINDOWEVENT) {
+		screenDirty = true;
+	}
+	return true;
+}
+
+// Sleeps until there is something to do: static screens wait for input, an unfocused
+// window runs at a reduced rate and a minimized one only handles events. Returns false
+// while minimized.
+bool waitForFrame(GameMode mode) {
+	Uint32 flags = SDL_GetWindowFlags(displayWindow);
+	if (flags & SDL_WINDOW_MINIMIZED) {
+		SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+		return false;
+	}
+	if (isStaticScreen(mode)) {
+		if (!screenDirty) {
+			SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+		}
+	}
+	else if (!(flags & SDL_WINDOW_INPUT_FOCUS)) {
+		SDL_WaitEventTimeout(NULL, UNFOCUSED_FRAME_MS);
+	}
+	return true;
+}
+
+void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& event, bool& done, Mix_Chunk* jumpSound,const SheetSprite& playerSprite, int levelOne[LEVEL_HEIGHT][LEVEL_WIDTH], int**& mapData) {
 	const Uint8* keys = SDL_GetKeyboardState(NULL);
 	switch (mode) {
 	case STATE_MAIN_MENU:
-		while (SDL_PollEvent(&event)) {
+		while (pollEvent(event)) {
 			if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT_CLOSE) {
 				done = true;
 			}
@@ -658,7 +801,7 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 		}
 		break;
 	case STATE_GUIDE_PAGE:
-		while (SDL_PollEvent(&event)) {
+		while (pollEvent(event)) {
 			if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT_CLOSE) {
 				done = true;
 			}
@@ -671,7 +814,7 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 	case STATE_LEVEL_ONE:
 	case STATE_LEVEL_TWO:
 	case STATE_LEVEL_THREE:
-		while (SDL_PollEvent(&event)) {
+		while (pollEvent(event)) {
 			if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT_CLOSE) {
 				done = true;
 			}
@@ -685,6 +828,8 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 				}
 			}
 		}
+		// held for every simulation step of this frame
+		state.player.acceleration.x = 0.0f;
 		if (keys[SDL_SCANCODE_LEFT]) {
 			state.player.acceleration.x = -2.0f;
 		}
@@ -694,17 +839,17 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 		}
 		else if (keys[SDL_SCANCODE_A]) {
 			if (state.player.canShoot) {
-				state.bullets.push_back(state.player.shoot(bulletSprite));
+				state.player.shoot(state.bullets);
 			}
 		}
 		else if (keys[SDL_SCANCODE_Q]) {
 			state.board = Entity();
-			state.enemies.clear();
-			state.bullets.clear();
-			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -45 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, "player", playerSprite);
+			state.enemies.Clear();
+			state.bullets.Clear();
+			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -45 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, ENTITY_PLAYER, playerSprite);
 			map.Load("levelOne.txt");
 			for (size_t i = 0; i < map.entities.size(); i++) {
-				placeEntity(state, map.entities[i].type, map.entities[i].x, map.entities[i].y, enemySprite);
+				placeEntity(state, map.entities[i].x, map.entities[i].y);
 			}
 			loadLevel(mapData, levelOne);
 			mode = STATE_MAIN_MENU;
@@ -712,15 +857,15 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 		}
 		break;
 	case STATE_GAME_OVER:
-		while (SDL_PollEvent(&event)) {
+		while (pollEvent(event)) {
 			if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT_CLOSE) {
 				done = true;
 			}
 			else if (event.type == SDL_MOUSEBUTTONDOWN) {
 				map.Load("levelOne.txt");
-				state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -45 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, "player", playerSprite);
+				state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -45 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, ENTITY_PLAYER, playerSprite);
 				for (size_t i = 0; i < map.entities.size(); i++) {
-					placeEntity(state, map.entities[i].type, map.entities[i].x, map.entities[i].y, enemySprite);
+					placeEntity(state, map.entities[i].x, map.entities[i].y);
 				}
 				loadLevel(mapData, levelOne);
 				mode = STATE_LEVEL_ONE;
@@ -731,145 +876,114 @@ void processEvents(GameState& state, GameMode& mode, FlareMap& map, SDL_Event& e
 	}
 }
 
-void Update(GameState& state, GameMode& mode, bool& flag, FlareMap& map, float& elapsed, Mix_Chunk* shootSound, Mix_Chunk* deadSound, const SheetSprite& playerSprite, const SheetSprite& enemySprite, const SheetSprite& bulletSprite, const SheetSprite& boardSprite, int levelTwo[LEVEL_HEIGHT][LEVEL_WIDTH], int levelThree[LEVEL_HEIGHT][LEVEL_WIDTH], int**& mapData) {
+void Update(GameState& state, GameMode& mode, bool& flag, FlareMap& map, float& elapsed, Mix_Chunk* shootSound, Mix_Chunk* deadSound, const SheetSprite& playerSprite, const SheetSprite& boardSprite, int levelTwo[LEVEL_HEIGHT][LEVEL_WIDTH], int levelThree[LEVEL_HEIGHT][LEVEL_WIDTH], int**& mapData) {
 	switch (mode) {
 	case STATE_MAIN_MENU:
 	case STATE_GUIDE_PAGE:
 		break;
 	case STATE_LEVEL_ONE:
 		state.player.update(mode, elapsed, mapData, state.player, state.board);
-		state.player.acceleration.x = 0.0f;
 		if (!state.player.alive) {
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			Mix_PlayChannel(-1, deadSound, 0);
 			flag = false;
 			mode = STATE_GAME_OVER;
 			break;
 		}
-		state.enemies.erase(remove_if(state.enemies.begin(), state.enemies.end(), shouldDie), state.enemies.end());
+		state.enemies.Compact();
 		if (state.player.exit) {
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			map.Load("levelTwo.txt");
 			for (size_t i = 0; i < map.entities.size(); i++) {
-				placeEntity(state, map.entities[i].type, map.entities[i].x, map.entities[i].y, enemySprite);
+				placeEntity(state, map.entities[i].x, map.entities[i].y);
 			}
 			loadLevel(mapData, levelTwo);
-			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, "player", playerSprite);
+			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, ENTITY_PLAYER, playerSprite);
 			mode = STATE_LEVEL_TWO;
 			break;
 		}
-		state.bullets.erase(remove_if(state.bullets.begin(), state.bullets.end(), shouldRemove), state.bullets.end());
-		for (size_t i = 0; i < state.bullets.size(); i++) {
-			if (state.player.collide(state.bullets[i])) {
-				if (state.bullets[i].parent->type == "enemy") {
-					state.enemies.clear();
-					state.bullets.clear();
-					Mix_PlayChannel(-1, deadSound, 0);
-					flag = false;
-					mode = STATE_GAME_OVER;
-					break;
-				}
-			}
-			for (size_t j = 0; j < state.enemies.size(); j++) {
-				if (state.enemies[j].collide(state.bullets[i])) {
-					if (state.bullets[i].parent->type == "player") {
-						state.bullets[i].collideSide = true;
-						state.enemies[j].alive = false;
-					}
-				}
-			}
-			state.bullets[i].update(mode, elapsed, mapData, state.player, state.board);
+		if (updateBullets(state, elapsed, mapData)) {
+			state.enemies.Clear();
+			state.bullets.Clear();
+			Mix_PlayChannel(-1, deadSound, 0);
+			flag = false;
+			mode = STATE_GAME_OVER;
+			break;
 		}
-		for (size_t i = 0; i < state.enemies.size(); i++) {
-			if (state.enemies[i].collide(state.player)) {
-				state.enemies.clear();
-				state.bullets.clear();
+		for (int i = 0; i < state.enemies.Count(); i++) {
+			if (boxesOverlap(state.enemies.x[i], state.enemies.y[i], TILE_SIZE, TILE_SIZE, state.player.position.x, state.player.position.y, state.player.size.x, state.player.size.y)) {
+				state.enemies.Clear();
+				state.bullets.Clear();
 				Mix_PlayChannel(-1, deadSound, 0);
 				flag = false;
 				mode = STATE_GAME_OVER;
 				break;
 			}
-			if (state.enemies[i].state == ALERT && state.enemies[i].accumalator >= ENEMY_GAP) {
-				state.bullets.push_back(state.enemies[i].shoot(bulletSprite));
-				state.enemies[i].accumalator -= ENEMY_GAP;
+			if (state.enemies.behavior[i] == ALERT && state.enemies.timer[i] >= ENEMY_GAP) {
+				enemyShoot(state.enemies, i, state.bullets);
+				state.enemies.timer[i] -= ENEMY_GAP;
 				Mix_PlayChannel(-1, shootSound, 0);
 			}
-			state.enemies[i].update(mode, elapsed, mapData, state.player, state.board);
 		}
+		updateEnemies(state, elapsed, mapData);
 		break;
 	case STATE_LEVEL_TWO:
 		state.player.update(mode, elapsed, mapData, state.player, state.board);
-		state.player.acceleration.x = 0.0f;
 		if (!state.player.alive) {
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			Mix_PlayChannel(-1, deadSound, 0);
 			flag = false;
 			mode = STATE_GAME_OVER;
 			break;
 		}
-		state.enemies.erase(remove_if(state.enemies.begin(), state.enemies.end(), shouldDie), state.enemies.end());
+		state.enemies.Compact();
 		if (state.player.exit) {
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			map.Load("levelThree.txt");
 			for (size_t i = 0; i < map.entities.size(); i++) {
-				placeEntity(state, map.entities[i].type, map.entities[i].x, map.entities[i].y, enemySprite);
+				placeEntity(state, map.entities[i].x, map.entities[i].y);
 			}
 			loadLevel(mapData, levelThree);
-			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, "player", playerSprite);
-			state.board = Entity(7 * TILE_SIZE + 0.5f * TILE_SIZE, -41 * TILE_SIZE - 0.5f * TILE_SIZE, 0.0F, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 4 * TILE_SIZE, TILE_SIZE, 0.0f, "board", boardSprite);
+			state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, ENTITY_PLAYER, playerSprite);
+			state.board = Entity(7 * TILE_SIZE + 0.5f * TILE_SIZE, -41 * TILE_SIZE - 0.5f * TILE_SIZE, 0.0F, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 4 * TILE_SIZE, TILE_SIZE, 0.0f, ENTITY_BOARD, boardSprite);
 			mode = STATE_LEVEL_THREE;
 			break;
 		}
-		state.bullets.erase(remove_if(state.bullets.begin(), state.bullets.end(), shouldRemove), state.bullets.end());
-		for (size_t i = 0; i < state.bullets.size(); i++) {
-			if (state.player.collide(state.bullets[i])) {
-				if (state.bullets[i].parent->type == "enemy") {
-					state.enemies.clear();
-					state.bullets.clear();
-					Mix_PlayChannel(-1, deadSound, 0);
-					flag = false;
-					mode = STATE_GAME_OVER;
-					break;
-				}
-			}
-			for (size_t j = 0; j < state.enemies.size(); j++) {
-				if (state.enemies[j].collide(state.bullets[i])) {
-					if (state.bullets[i].parent->type == "player") {
-						state.bullets[i].collideSide = true;
-						state.enemies[j].alive = false;
-					}
-				}
-			}
-			state.bullets[i].update(mode, elapsed, mapData, state.player, state.board);
+		if (updateBullets(state, elapsed, mapData)) {
+			state.enemies.Clear();
+			state.bullets.Clear();
+			Mix_PlayChannel(-1, deadSound, 0);
+			flag = false;
+			mode = STATE_GAME_OVER;
+			break;
 		}
-		for (size_t i = 0; i < state.enemies.size(); i++) {
-			if (state.enemies[i].collide(state.player)) {
-				state.enemies.clear();
-				state.bullets.clear();
+		for (int i = 0; i < state.enemies.Count(); i++) {
+			if (boxesOverlap(state.enemies.x[i], state.enemies.y[i], TILE_SIZE, TILE_SIZE, state.player.position.x, state.player.position.y, state.player.size.x, state.player.size.y)) {
+				state.enemies.Clear();
+				state.bullets.Clear();
 				Mix_PlayChannel(-1, deadSound, 0);
 				flag = false;
 				mode = STATE_GAME_OVER;
 				break;
 			}
-			if (state.enemies[i].state == ALERT && state.enemies[i].accumalator >= ENEMY_GAP) {
-				state.bullets.push_back(state.enemies[i].shoot(bulletSprite));
-				state.enemies[i].accumalator -= ENEMY_GAP;
+			if (state.enemies.behavior[i] == ALERT && state.enemies.timer[i] >= ENEMY_GAP) {
+				enemyShoot(state.enemies, i, state.bullets);
+				state.enemies.timer[i] -= ENEMY_GAP;
 				Mix_PlayChannel(-1, shootSound, 0);
 			}
-			state.enemies[i].update(mode, elapsed, mapData, state.player, state.board);
 		}
+		updateEnemies(state, elapsed, mapData);
 		break;
 	case STATE_LEVEL_THREE:
 		state.player.update(mode, elapsed, mapData, state.player, state.board);
-		state.player.acceleration.x = 0.0f;
 		if (!state.player.alive) {
 			state.board = Entity();
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			Mix_PlayChannel(-1, deadSound, 0);
 			flag = false;
 			mode = STATE_GAME_OVER;
@@ -877,150 +991,338 @@ void Update(GameState& state, GameMode& mode, bool& flag, FlareMap& map, float&
 		}
 		if (state.player.switchOn(mapData)) {
 			state.board.velocity.x = 2.0f;
-			mapData[46][1] = 252;
+			setTile(mapData, 46, 1, 252);
 		}
 		state.board.update(mode, elapsed, mapData, state.player, state.board);
-		state.enemies.erase(remove_if(state.enemies.begin(), state.enemies.end(), shouldDie), state.enemies.end());
+		state.enemies.Compact();
 		if (state.player.exit) {
-			state.enemies.clear();
-			state.bullets.clear();
+			state.enemies.Clear();
+			state.bullets.Clear();
 			state.board = Entity();
 			flag = true;
 			mode = STATE_GAME_OVER;
 			break;
 		}
-		state.bullets.erase(remove_if(state.bullets.begin(), state.bullets.end(), shouldRemove), state.bullets.end());
-		for (size_t i = 0; i < state.bullets.size(); i++) {
-			if (state.player.collide(state.bullets[i])) {
-				if (state.bullets[i].parent->type == "enemy") {
-					state.enemies.clear();
-					state.bullets.clear();
-					state.board = Entity();
-					Mix_PlayChannel(-1, deadSound, 0);
-					mode = STATE_GAME_OVER;
-					break;
-				}
-			}
-			for (size_t j = 0; j < state.enemies.size(); j++) {
-				if (state.enemies[j].collide(state.bullets[i])) {
-					if (state.bullets[i].parent->type == "player") {
-						state.bullets[i].collideSide = true;
-						state.enemies[j].alive = false;
-					}
-				}
-			}
-			state.bullets[i].update(mode, elapsed, mapData, state.player, state.board);
+		if (updateBullets(state, elapsed, mapData)) {
+			state.enemies.Clear();
+			state.bullets.Clear();
+			state.board = Entity();
+			Mix_PlayChannel(-1, deadSound, 0);
+			mode = STATE_GAME_OVER;
+			break;
 		}
-		for (size_t i = 0; i < state.enemies.size(); i++) {
-			if (state.enemies[i].collide(state.player)) {
-				state.enemies.clear();
-				state.bullets.clear();
+		for (int i = 0; i < state.enemies.Count(); i++) {
+			if (boxesOverlap(state.enemies.x[i], state.enemies.y[i], TILE_SIZE, TILE_SIZE, state.player.position.x, state.player.position.y, state.player.size.x, state.player.size.y)) {
+				state.enemies.Clear();
+				state.bullets.Clear();
 				Mix_PlayChannel(-1, deadSound, 0);
 				flag = false;
 				state.board = Entity();
 				mode = STATE_GAME_OVER;
 				break;
 			}
-			if (state.enemies[i].state == ALERT && state.enemies[i].accumalator >= ENEMY_GAP) {
-				state.bullets.push_back(state.enemies[i].shoot(bulletSprite));
-				state.enemies[i].accumalator -= ENEMY_GAP;
+			if (state.enemies.behavior[i] == ALERT && state.enemies.timer[i] >= ENEMY_GAP) {
+				enemyShoot(state.enemies, i, state.bullets);
+				state.enemies.timer[i] -= ENEMY_GAP;
 				Mix_PlayChannel(-1, shootSound, 0);
 			}
-			state.enemies[i].update(mode, elapsed, mapData, state.player, state.board);
 		}
+		updateEnemies(state, elapsed, mapData);
 		break;
 	case STATE_GAME_OVER:
 		break;
 	}
 }
 
-void render(GameState& state, GameMode& mode, ShaderProgram* program, int textureID, int fontTexture, int playerTexture, const Entity& player, const int* runAnimation, const int* jumpAnimation, const int jumpFrames, const int walkFrames, float& walkElapsed, float& jumpElapsed, float framesPerSecond, int& walkIndex, int& jumpIndex, const FlareMap& map, bool& flag, float& elapsed, int**& mapData) {
+void render(GameState& state, GameMode& mode, ShaderProgram* program, int atlasTexture, const AtlasRegion& fontRegion, const AtlasRegion& playerRegion, const Entity& player, const int* runAnimation, const int* jumpAnimation, const int jumpFrames, const int walkFrames, float& walkElapsed, float& jumpElapsed, float framesPerSecond, int& walkIndex, int& jumpIndex, const FlareMap& map, bool& flag, float& elapsed, int**& mapData, float alpha) {
+	Matrix projectionMatrix;
+	Matrix viewMatrix;
+	Vector3 camera;
+	projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
 	switch (mode) {
 	case STATE_MAIN_MENU:
-		glClear(GL_COLOR_BUFFER_BIT);
-		drawText(program, fontTexture, "Welcome to My World!", 0.3f, 0.0f, -2.8f, 1.0f);
-		drawText(program, fontTexture, "PLAY", 0.5f, 0.0f, -0.8f, -0.1f);
-		drawText(program, fontTexture, "Press Mouse to Start", 0.25f, 0.0f, -2.3f, -1.0f);
+		renderQueue.Begin(program, projectionMatrix, viewMatrix);
+		drawText(renderQueue, atlasTexture, fontRegion, "Welcome to My World!", 0.3f, 0.0f, -2.8f, 1.0f);
+		drawPanel(renderQueue, -0.05f, -0.1f, 2.3f, 0.7f);
+		drawText(renderQueue, atlasTexture, fontRegion, "PLAY", 0.5f, 0.0f, -0.8f, -0.1f);
+		drawText(renderQueue, atlasTexture, fontRegion, "Press Mouse to Start", 0.25f, 0.0f, -2.3f, -1.0f);
 		break;
 	case STATE_GUIDE_PAGE:
-		glClear(GL_COLOR_BUFFER_BIT);
-		drawText(program, fontTexture, "Guides", 0.5f, 0.0f, -1.2f, 1.2f);
-		drawText(program, fontTexture, "1. Press left or right to move", 0.2f, 0.0f, -3.0f, 0.5f);
-		drawText(program, fontTexture, "2. Press space to jump", 0.2f, 0.0f, -3.0f, 0.0f);
-		drawText(program, fontTexture, "3. Press A to shoot", 0.2f, 0.0f, -3.0f, -0.5f);
-		drawText(program, fontTexture, "4. Press Q to quit", 0.2f, 0.0f, -3.0f, -1.0f);
-		drawText(program, fontTexture, "(Tip: Mind the floor!)", 0.2f, 0.0f, -2.0f, -1.5f);
+		renderQueue.Begin(program, projectionMatrix, viewMatrix);
+		drawText(renderQueue, atlasTexture, fontRegion, "Guides", 0.5f, 0.0f, -1.2f, 1.2f);
+		drawText(renderQueue, atlasTexture, fontRegion, "1. Press left or right to move", 0.2f, 0.0f, -3.0f, 0.5f);
+		drawText(renderQueue, atlasTexture, fontRegion, "2. Press space to jump", 0.2f, 0.0f, -3.0f, 0.0f);
+		drawText(renderQueue, atlasTexture, fontRegion, "3. Press A to shoot", 0.2f, 0.0f, -3.0f, -0.5f);
+		drawText(renderQueue, atlasTexture, fontRegion, "4. Press Q to quit", 0.2f, 0.0f, -3.0f, -1.0f);
+		drawText(renderQueue, atlasTexture, fontRegion, "(Tip: Mind the floor!)", 0.2f, 0.0f, -2.0f, -1.5f);
 		break;
 	case STATE_LEVEL_ONE:
 	case STATE_LEVEL_TWO:
-		glClear(GL_COLOR_BUFFER_BIT);
-		drawTile(program, textureID, map, state.player, mapData);
+		camera = state.player.renderPosition(alpha);
+		viewMatrix.Translate(-camera.x, -camera.y, -camera.z);
+		renderQueue.Begin(program, projectionMatrix, viewMatrix);
+		drawTile(renderQueue, atlasTexture, map, camera, mapData);
 		if (state.player.velocity.x != 0.0f) {
 			if (state.player.velocity.y <= 0.0f) {
-				renderPlayer(program, playerTexture, player, runAnimation, walkFrames, walkElapsed, framesPerSecond, elapsed, walkIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, runAnimation, walkFrames, walkElapsed, framesPerSecond, elapsed, walkIndex, alpha);
 			}
 			else {
-				renderPlayer(program, playerTexture, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex, alpha);
 			}
 		}
 		else {
 			if (state.player.velocity.y <= 0.0f) {
-				state.player.draw(program, state.player);
+				state.player.draw(renderQueue, alpha);
 			}
 			else {
-				renderPlayer(program, playerTexture, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex, alpha);
 			}
 		}
-		for (size_t i = 0; i < state.enemies.size(); i++) {
-			state.enemies[i].draw(program, state.player);
+		for (int i = 0; i < state.enemies.Count(); i++) {
+			float enemyX = lerp(state.enemies.previousX[i], state.enemies.x[i], alpha);
+			float enemyY = lerp(state.enemies.previousY[i], state.enemies.y[i], alpha);
+			renderQueue.SubmitInstance(LAYER_WORLD, state.enemySprite.textureID, 0.0f, enemyX, enemyY, TILE_SIZE, TILE_SIZE, state.enemySprite.u, state.enemySprite.v, state.enemySprite.width, state.enemySprite.height);
 		}
-		for (size_t j = 0; j < state.bullets.size(); j++) {
-			state.bullets[j].draw(program, state.player);
+		for (int j = 0; j < state.bullets.Count(); j++) {
+			float bulletX = lerp(state.bullets.previousX[j], state.bullets.x[j], alpha);
+			float bulletY = lerp(state.bullets.previousY[j], state.bullets.y[j], alpha);
+			renderQueue.SubmitInstance(LAYER_WORLD, state.bulletSprite.textureID, 0.0f, bulletX, bulletY, TILE_SIZE, TILE_SIZE, state.bulletSprite.u, state.bulletSprite.v, state.bulletSprite.width, state.bulletSprite.height);
 		}
 		break;
 	case STATE_LEVEL_THREE:
-		glClear(GL_COLOR_BUFFER_BIT);
-		drawTile(program, textureID, map, state.player, mapData);
+		camera = state.player.renderPosition(alpha);
+		viewMatrix.Translate(-camera.x, -camera.y, -camera.z);
+		renderQueue.Begin(program, projectionMatrix, viewMatrix);
+		drawTile(renderQueue, atlasTexture, map, camera, mapData);
 		if (state.player.velocity.x != 0.0f) {
 			if (state.player.velocity.y <= 0.0f) {
-				renderPlayer(program, playerTexture, player, runAnimation, walkFrames, walkElapsed, framesPerSecond, elapsed, walkIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, runAnimation, walkFrames, walkElapsed, framesPerSecond, elapsed, walkIndex, alpha);
 			}
 			else {
-				renderPlayer(program, playerTexture, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex, alpha);
 			}
 		}
 		else {
 			if (state.player.velocity.y <= 0.0f) {
-				state.player.draw(program, state.player);
+				state.player.draw(renderQueue, alpha);
 			}
 			else {
-				renderPlayer(program, playerTexture, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex);
+				renderPlayer(renderQueue, atlasTexture, playerRegion, player, jumpAnimation, jumpFrames, jumpElapsed, framesPerSecond, elapsed, jumpIndex, alpha);
 			}
 		}
-		for (size_t i = 0; i < state.enemies.size(); i++) {
-			state.enemies[i].draw(program, state.player);
+		for (int i = 0; i < state.enemies.Count(); i++) {
+			float enemyX = lerp(state.enemies.previousX[i], state.enemies.x[i], alpha);
+			float enemyY = lerp(state.enemies.previousY[i], state.enemies.y[i], alpha);
+			renderQueue.SubmitInstance(LAYER_WORLD, state.enemySprite.textureID, 0.0f, enemyX, enemyY, TILE_SIZE, TILE_SIZE, state.enemySprite.u, state.enemySprite.v, state.enemySprite.width, state.enemySprite.height);
 		}
-		for (size_t j = 0; j < state.bullets.size(); j++) {
-			state.bullets[j].draw(program, state.player);
+		for (int j = 0; j < state.bullets.Count(); j++) {
+			float bulletX = lerp(state.bullets.previousX[j], state.bullets.x[j], alpha);
+			float bulletY = lerp(state.bullets.previousY[j], state.bullets.y[j], alpha);
+			renderQueue.SubmitInstance(LAYER_WORLD, state.bulletSprite.textureID, 0.0f, bulletX, bulletY, TILE_SIZE, TILE_SIZE, state.bulletSprite.u, state.bulletSprite.v, state.bulletSprite.width, state.bulletSprite.height);
 		}
-		state.board.draw(program, state.player);
+		state.board.draw(renderQueue, alpha);
 		break;
 	case STATE_GAME_OVER:
-		glClear(GL_COLOR_BUFFER_BIT);
+		renderQueue.Begin(program, projectionMatrix, viewMatrix);
 		if (!flag) {
-			drawText(program, fontTexture, "YOU LOSE!", 0.4f, 0.1f, -2.0f, 1.0f);
+			drawText(renderQueue, atlasTexture, fontRegion, "YOU LOSE!", 0.4f, 0.1f, -2.0f, 1.0f);
 		}
 		else {
-			drawText(program, fontTexture, "Congratulations!", 0.4f, 0.0f, -3.0f, 1.0f);
+			drawText(renderQueue, atlasTexture, fontRegion, "Congratulations!", 0.4f, 0.0f, -3.0f, 1.0f);
 		}
-		drawText(program, fontTexture, "Play Again?", 0.4f, 0.0f, -2.0f, -0.5f);
+		drawPanel(renderQueue, 0.0f, -0.5f, 4.6f, 0.6f);
+		drawText(renderQueue, atlasTexture, fontRegion, "Play Again?", 0.4f, 0.0f, -2.0f, -0.5f);
 		break;
 	}
 }
 
+// runs on the render thread, or inline in headless mode
+void drawFrame(RenderFrame& frame) {
+	ShaderProgram::stats.Reset();
+	if (!frame.levelTiles.empty()) {
+		renderQueue.tileAnimations.Build(frame.levelAnimations);
+		if (useShaderTiles) {
+			shaderTileMap.Build(frame.levelTiles.data(), frame.levelWidth, frame.levelHeight, SPRITE_COUNT_X, SPRITE_COUNT_Y, TILE_SIZE);
+		}
+		else {
+			tileMesh.Build(frame.levelTiles.data(), frame.levelWidth, frame.levelHeight, SPRITE_COUNT_X, SPRITE_COUNT_Y, TILE_SIZE);
+		}
+	}
+	for (size_t i = 0; i < frame.tileChanges.size(); i++) {
+		const TileChange& change = frame.tileChanges[i];
+		if (useShaderTiles) {
+			shaderTileMap.SetTile(change.gridX, change.gridY, change.value);
+		}
+		else {
+			tileMesh.SetTile(change.gridX, change.gridY, change.value);
+		}
+	}
+	if (useDynamicResolution) {
+		resolutionScaler.Begin();
+	}
+	renderQueue.Execute(frame);
+	if (useDynamicResolution) {
+		resolutionScaler.End();
+	}
+	frameCapture.Capture();
+	stateCacheTotals.Add(ShaderProgram::stats);
+}
+
+void recordFrame(OffscreenTarget& offscreen, const LaunchOptions& options, int frameIndex) {
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)offscreen.HashFrame());
+	cout << "frame " << frameIndex << " " << hash << endl;
+	if (options.dumpFolder != nullptr) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/frame%05d.ppm", options.dumpFolder, frameIndex);
+		offscreen.WriteFrame(path);
+	}
+}
+
+// Counters the renderer and simulation keep over a headless run, gathered once at the end so
+// one printer writes them all and one checker turns the ones that must hold into the exit status.
+struct RunReport {
+	int frames;
+	double renderMs;
+	double stepMs;
+	int droppedSteps;
+	int stressBullets;
+	bool checkGrid;
+	int gridMisses;
+	int tileCount;
+	int tileQuads;
+	int spriteDrawCalls;
+	int spriteQuads;
+	int instanceDrawCalls;
+	int lastInstanceBatch;
+	int textHits;
+	int textMisses;
+	int flaggedTiles;
+	int animatedTiles;
+	int streamStalls;
+	GLStateStats stateCache;
+	size_t textureMemory;
+	size_t textureBudget;
+};
+
+RunReport gatherRunReport(const LaunchOptions& options, int frames, Uint64 renderTicks, Uint64 simulationTicks, int simulationSteps, int droppedSteps, int gridMisses) {
+	RunReport report;
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	report.frames = frames;
+	report.renderMs = frames > 0 ? (double)renderTicks * 1000.0 / frequency / frames : 0.0;
+	report.stepMs = simulationSteps > 0 ? (double)simulationTicks * 1000.0 / frequency / simulationSteps : 0.0;
+	report.droppedSteps = droppedSteps;
+	report.stressBullets = options.play ? options.stressBullets : 0;
+	report.checkGrid = options.checkGrid;
+	report.gridMisses = gridMisses;
+	report.tileCount = useShaderTiles ? 0 : tileMesh.GetTileCount();
+	report.tileQuads = useShaderTiles ? 0 : tileMesh.GetQuadCount();
+	report.spriteDrawCalls = renderQueue.spriteBatch.drawCalls;
+	report.spriteQuads = renderQueue.spriteBatch.quadCount;
+	report.instanceDrawCalls = renderQueue.instanceBatch.drawCalls;
+	report.lastInstanceBatch = renderQueue.instanceBatch.instanceCount;
+	report.textHits = renderQueue.textCache.hits;
+	report.textMisses = renderQueue.textCache.misses;
+	report.flaggedTiles = tileProperties.flaggedTiles;
+	report.animatedTiles = renderQueue.tileAnimations.animatedTiles;
+	report.streamStalls = renderQueue.streamBuffer.stalls;
+	report.stateCache = stateCacheTotals;
+	report.textureMemory = resources.GetTextureMemory();
+	report.textureBudget = resources.textureBudget;
+	return report;
+}
+
+void printRunReport(const RunReport& report, ostream& out) {
+	out << "average render " << report.renderMs << " ms over " << report.frames << " frames" << endl;
+	resources.PrintReport(out);
+	out << "simulation: " << report.droppedSteps << " steps dropped, " << report.stepMs << " ms per step";
+	if (report.stressBullets > 0) {
+		out << " with " << report.stressBullets << " stress bullets";
+	}
+	out << endl;
+	if (report.checkGrid) {
+		out << "grid check: " << report.gridMisses << " overlapping pairs missed by the grid over " << report.frames << " frames" << endl;
+	}
+	if (!useShaderTiles) {
+		out << "tile layer: " << report.tileCount << " tiles in " << report.tileQuads << " quads" << endl;
+	}
+	out << "sprite batch: " << report.spriteDrawCalls << " draw calls for " << report.spriteQuads << " quads, " << (double)report.spriteDrawCalls / report.frames << " draw calls per frame" << endl;
+	out << "instance batch: " << report.instanceDrawCalls << " draw calls, " << report.lastInstanceBatch << " instances in the last batch" << endl;
+	out << "text cache: " << report.textHits << " hits, " << report.textMisses << " misses" << endl;
+	out << "tile properties: " << report.flaggedTiles << " flagged tiles" << endl;
+	out << "tile animations: " << report.animatedTiles << " animated tiles" << endl;
+	const char *streamModes[] = { "persistent", "unsynchronized", "orphan" };
+	out << "stream buffer: " << streamModes[renderQueue.streamBuffer.mode] << " mapping, " << report.streamStalls << " fence stalls" << endl;
+	const GLStateStats& stats = report.stateCache;
+	out << "state cache: " << stats.programBinds << " program binds (" << stats.programBindsSkipped << " skipped), " << stats.textureBinds << " texture binds (" << stats.textureBindsSkipped << " skipped), " << stats.uniformUploads << " uniform uploads (" << stats.uniformUploadsSkipped << " skipped)" << endl;
+}
+
+// prints every broken invariant and returns false if there was one
+bool checkRunReport(const RunReport& report, const LaunchOptions& options, ostream& out) {
+	bool passed = true;
+	if (report.checkGrid && report.gridMisses > 0) {
+		out << "check failed: the grid missed " << report.gridMisses << " overlapping pairs" << endl;
+		passed = false;
+	}
+	// the shared tileset file feeds both tables, every level relies on them
+	if (report.flaggedTiles == 0) {
+		out << "check failed: no tile has gameplay properties" << endl;
+		passed = false;
+	}
+	if (report.animatedTiles == 0) {
+		out << "check failed: no tile is animated" << endl;
+		passed = false;
+	}
+	const GLStateStats& stats = report.stateCache;
+	if (report.frames > 1 && stats.programBindsSkipped + stats.textureBindsSkipped + stats.uniformUploadsSkipped == 0) {
+		out << "check failed: the state cache skipped nothing over " << report.frames << " frames" << endl;
+		passed = false;
+	}
+	// strings repeat from frame to frame, so a working cache hits far more often than it misses
+	if (report.textMisses > report.textHits) {
+		out << "check failed: the text cache missed " << report.textMisses << " times and hit " << report.textHits << " times" << endl;
+		passed = false;
+	}
+	if (report.textureBudget > 0 && report.textureMemory > report.textureBudget) {
+		out << "check failed: " << report.textureMemory / 1024 << " KB of textures, over the " << report.textureBudget / 1024 << " KB budget" << endl;
+		passed = false;
+	}
+	float drawCalls = (float)(report.spriteDrawCalls + report.instanceDrawCalls) / report.frames;
+	if (options.maxDrawCalls > 0.0f && drawCalls > options.maxDrawCalls) {
+		out << "check failed: " << drawCalls << " batch draw calls per frame, over the limit of " << options.maxDrawCalls << endl;
+		passed = false;
+	}
+	return passed;
+}
+
 int main(int argc, char *argv[])
 {
-	setUp();
+	LaunchOptions options = parseLaunchOptions(argc, argv);
+	useShaderTiles = options.shaderTiles;
+	tileMesh.greedy = options.greedy;
+	useDynamicResolution = options.dynamicResolution;
+	if (options.frameBudget > 0.0f) {
+		resolutionScaler.frameBudget = options.frameBudget;
+	}
+	setUp(options);
+	OffscreenTarget offscreen;
+	if (options.headless) {
+		if (!offscreen.Create(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+			SDL_Quit();
+			return 1;
+		}
+		offscreen.Bind();
+		// timing driven scaling would make the frame hashes depend on the machine
+		useDynamicResolution = false;
+	}
+	else if (useDynamicResolution) {
+		useDynamicResolution = resolutionScaler.Create(WINDOW_WIDTH, WINDOW_HEIGHT);
+	}
+	if (options.capturePath != nullptr) {
+		string path = options.capturePath;
+		bool y4m = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+		frameCapture.Start(WINDOW_WIDTH, WINDOW_HEIGHT, y4m ? CAPTURE_Y4M : CAPTURE_PNG, options.capturePath);
+	}
 	Mix_Chunk* shootSound;
 	shootSound = Mix_LoadWAV("shoot.wav");
 	Mix_Chunk* jumpSound;
@@ -1029,28 +1331,44 @@ int main(int argc, char *argv[])
 	deadSound = Mix_LoadWAV("dead.wav");
 	Mix_Music* Background;
 	Background = Mix_LoadMUS("Background.mp3");
-	ShaderProgram program;
-	program.Load(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	ShaderProgram* program = resources.LoadProgram(RESOURCE_FOLDER"vertex_sprite.glsl", RESOURCE_FOLDER"fragment_sprite.glsl", RESOURCE_FOLDER"tile_animation.glsl");
+	renderQueue.tileAnimations.Configure(SPRITE_COUNT_X, SPRITE_COUNT_Y);
+	renderQueue.tileAnimations.Attach(program);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	GameState state;
 	GameMode mode = STATE_MAIN_MENU;
-	GLuint textureID = loadTexture("platformer.png");
-	GLuint fontTexture = loadTexture("font1.png");
-	GLuint playerTexture = loadTexture("playerSprite.png");
-	float enemy_u = (float)((373 % SPRITE_COUNT_X) / (float)SPRITE_COUNT_X);
-	float enemy_v = (float)((373 / SPRITE_COUNT_X) / (float)SPRITE_COUNT_Y);
-	SheetSprite enemySprite = SheetSprite(textureID, enemy_u, enemy_v, 1.0f / SPRITE_COUNT_X, 1.0f / SPRITE_COUNT_Y, TILE_SIZE);
-	float bullet_u = (float)((106 % SPRITE_COUNT_X) / (float)SPRITE_COUNT_X);
-	float bullet_v = (float)((106 / SPRITE_COUNT_X) / (float)SPRITE_COUNT_Y);
-	SheetSprite bulletSprite = SheetSprite(textureID, bullet_u, bullet_v, 1.0f / SPRITE_COUNT_X, 1.0f / SPRITE_COUNT_Y, TILE_SIZE);
-	float board_u = (float)((395 % SPRITE_COUNT_X) / (float)SPRITE_COUNT_X);
-	float board_v = (float)((395 / SPRITE_COUNT_X) / (float)SPRITE_COUNT_Y);
-	SheetSprite boardSprite = SheetSprite(textureID, board_u, board_v, 4.0f / SPRITE_COUNT_X, 1.0f / SPRITE_COUNT_Y, TILE_SIZE);
-	float player_u = (float)((7 % 7) / (float)7);
-	float player_v = (float)((7 / 7) / (float)3);
-	SheetSprite playerSprite = SheetSprite(playerTexture, player_u, player_v, 1.0f / 7.0f, 1.0f / 3.0f, TILE_SIZE);
-	state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, "player", playerSprite);
+	resources.textureBudget = (size_t)options.textureBudget * 1024;
+	TextureAtlas atlas;
+	atlas.Add("platformer.png");
+	atlas.Add("font1.png");
+	atlas.Add("playerSprite.png");
+	GLuint atlasTexture = atlas.Pack(2, resources, TextureOptions(true, false));
+	AtlasRegion tileRegion = atlas.GetRegion("platformer.png");
+	AtlasRegion fontRegion = atlas.GetRegion("font1.png");
+	AtlasRegion playerRegion = atlas.GetRegion("playerSprite.png");
+	tileMesh.SetAtlasRegion(tileRegion);
+	if (useShaderTiles) {
+		shaderTileMap.Load(resources.LoadProgram(RESOURCE_FOLDER"vertex_tilemap.glsl", RESOURCE_FOLDER"fragment_tilemap.glsl", RESOURCE_FOLDER"tile_animation.glsl"));
+		renderQueue.tileAnimations.Attach(shaderTileMap.program);
+		shaderTileMap.SetAtlasRegion(tileRegion);
+	}
+	float enemy_u, enemy_v, enemy_width, enemy_height;
+	tileRegion.MapCell(373, SPRITE_COUNT_X, SPRITE_COUNT_Y, enemy_u, enemy_v, enemy_width, enemy_height);
+	state.enemySprite = SheetSprite(atlasTexture, enemy_u, enemy_v, enemy_width, enemy_height, TILE_SIZE);
+	float bullet_u, bullet_v, bullet_width, bullet_height;
+	tileRegion.MapCell(106, SPRITE_COUNT_X, SPRITE_COUNT_Y, bullet_u, bullet_v, bullet_width, bullet_height);
+	state.bulletSprite = SheetSprite(atlasTexture, bullet_u, bullet_v, bullet_width, bullet_height, TILE_SIZE);
+	// bullets and enemies are TILE_SIZE boxes, so overlapping centres are at most a tile apart
+	static_assert(COLLISION_CELL_TILES * TILE_SIZE >= 0.5f * TILE_SIZE + 0.5f * TILE_SIZE, "collision cells must cover an enemy and a bullet half-size");
+	state.enemyGrid.Resize(LEVEL_WIDTH / COLLISION_CELL_TILES, LEVEL_HEIGHT / COLLISION_CELL_TILES, COLLISION_CELL_TILES * TILE_SIZE);
+	float board_u, board_v, board_width, board_height;
+	tileRegion.MapCell(395, SPRITE_COUNT_X, SPRITE_COUNT_Y, board_u, board_v, board_width, board_height);
+	SheetSprite boardSprite = SheetSprite(atlasTexture, board_u, board_v, 4.0f * board_width, board_height, TILE_SIZE);
+	float player_u, player_v, player_width, player_height;
+	playerRegion.MapCell(7, 7, 3, player_u, player_v, player_width, player_height);
+	SheetSprite playerSprite = SheetSprite(atlasTexture, player_u, player_v, player_width, player_height, TILE_SIZE);
+	state.player = Entity(4 * TILE_SIZE + 0.5F * TILE_SIZE, -46 * TILE_SIZE - 0.5F * TILE_SIZE, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, TILE_SIZE * 0.75f, TILE_SIZE, 0.0F, ENTITY_PLAYER, playerSprite);
 	int** mapData = new int*[LEVEL_HEIGHT];
 	for (size_t i = 0; i < LEVEL_HEIGHT; i++) {
 		mapData[i] = new int[LEVEL_WIDTH];
@@ -1202,16 +1520,23 @@ int main(int argc, char *argv[])
 	{333,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,333},
 	{333,251,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,333},
 	{123,123,123,123,123,123,71,71,71,71,71,123,123,123,123,123,123,71,71,71,71,71,123,123,123,123,123,123,123,71,71,71,71,71,123,123,123,123,123,123,71,71,71,71,71,123,123,123,123,123,123,71,71,71,71,71,123,123,123,123,123,123,123,123} };
+	tileset.Load("platformer.txt");
+	tileProperties.Build(tileset.tileProperties, SPRITE_COUNT_X * SPRITE_COUNT_Y);
 	FlareMap map;
 	map.Load("levelOne.txt");
 	for (size_t i = 0; i < map.entities.size(); i++) {
-		placeEntity(state, map.entities[i].type, map.entities[i].x, map.entities[i].y, enemySprite);
+		placeEntity(state, map.entities[i].x, map.entities[i].y);
 	}
 	loadLevel(mapData, levelOne);
 	bool done = false;
 	bool flag = false;
 	SDL_Event event;
-	float lastFrameTicks = 0.0f;
+	Uint64 counterFrequency = SDL_GetPerformanceFrequency();
+	Uint64 lastCounter = SDL_GetPerformanceCounter();
+	double accumulator = 0.0;
+	float alpha = 0.0f;
+	int droppedSteps = 0;
+	float animationTime = 0.0f;
 	const int runAnimation[] = { 7, 8, 9, 10, 11 };
 	const int jumpAnimation[] = { 13 };
 	const int walkFrames = 5;
@@ -1222,21 +1547,117 @@ int main(int argc, char *argv[])
 	int walkIndex = 0;
 	int jumpIndex = 0;
 	Mix_PlayMusic(Background, -1);
+	int frameIndex = 0;
+	Uint64 renderTicks = 0;
+	Uint64 simulationTicks = 0;
+	int simulationSteps = 0;
+	int gridMisses = 0;
+	bool passed = true;
+	if (options.play) {
+		mode = STATE_LEVEL_ONE;
+		spawnStressBullets(state, mapData, options.stressBullets);
+	}
+	// headless runs stay serial so every hash matches the frame that was just simulated
+	RenderThread renderThread;
+	if (!options.headless) {
+		renderThread.Start(displayWindow, glContext, drawFrame);
+	}
 	while (!done) {
-		float ticks = (float)SDL_GetTicks() / 1000.0f;
-		float elapsed = ticks - lastFrameTicks;
-		lastFrameTicks = ticks;
-		render(state, mode, &program, textureID, fontTexture, playerTexture, state.player, runAnimation, jumpAnimation, jumpFrames, walkFrames, walkElapsed, jumpElapsed, framesPerSecond, walkIndex, jumpIndex, map, flag, elapsed, mapData);
-		processEvents(state, mode, map, event, done, jumpSound, playerSprite, enemySprite, bulletSprite, levelOne, mapData);
-		Update(state, mode, flag, map, elapsed, shootSound, deadSound, playerSprite, enemySprite, bulletSprite, boardSprite, levelTwo, levelThree, mapData);
-		SDL_GL_SwapWindow(displayWindow);
+		bool visible = options.headless || waitForFrame(mode);
+		float elapsed;
+		if (options.headless) {
+			// exactly one step per frame so the same frame count always produces the same hashes
+			elapsed = FIXED_TIMESTEP;
+		}
+		else {
+			Uint64 counter = SDL_GetPerformanceCounter();
+			elapsed = (float)((double)(counter - lastCounter) / counterFrequency);
+			lastCounter = counter;
+			if (!visible || isStaticScreen(mode)) {
+				// time spent waiting for input must not reach the simulation
+				elapsed = 0.0f;
+			}
+		}
+		animationTime += elapsed;
+		renderQueue.SetTime(animationTime);
+		if (options.headless) {
+			render(state, mode, program, atlasTexture, fontRegion, playerRegion, state.player, runAnimation, jumpAnimation, jumpFrames, walkFrames, walkElapsed, jumpElapsed, framesPerSecond, walkIndex, jumpIndex, map, flag, elapsed, mapData, alpha);
+			Uint64 renderStart = SDL_GetPerformanceCounter();
+			drawFrame(*renderQueue.EndFrame());
+			glFinish();
+			renderTicks += SDL_GetPerformanceCounter() - renderStart;
+			recordFrame(offscreen, options, frameIndex);
+		}
+		else if (visible && (!isStaticScreen(mode) || screenDirty)) {
+			// static screens are only presented again after something on them changed
+			render(state, mode, program, atlasTexture, fontRegion, playerRegion, state.player, runAnimation, jumpAnimation, jumpFrames, walkFrames, walkElapsed, jumpElapsed, framesPerSecond, walkIndex, jumpIndex, map, flag, elapsed, mapData, alpha);
+			// the previous frame must be off the other buffer before it is reused
+			renderThread.WaitIdle();
+			renderThread.Submit(renderQueue.EndFrame());
+			screenDirty = false;
+		}
+		GameMode previousMode = mode;
+		processEvents(state, mode, map, event, done, jumpSound, playerSprite, levelOne, mapData);
+		// the simulation only ever advances in FIXED_TIMESTEP steps, at most MAX_TIMESTEPS a frame
+		accumulator += elapsed;
+		float step = FIXED_TIMESTEP;
+		int steps = 0;
+		Uint64 simulationStart = SDL_GetPerformanceCounter();
+		while (accumulator >= FIXED_TIMESTEP && steps < MAX_TIMESTEPS) {
+			state.savePositions();
+			Update(state, mode, flag, map, step, shootSound, deadSound, playerSprite, boardSprite, levelTwo, levelThree, mapData);
+			accumulator -= FIXED_TIMESTEP;
+			steps++;
+		}
+		simulationTicks += SDL_GetPerformanceCounter() - simulationStart;
+		simulationSteps += steps;
+		// outside the timed steps; Update buckets the enemies again before it uses the grid
+		if (options.headless && options.checkGrid) {
+			state.bucketEnemies();
+			gridMisses += checkEnemyGrid(state);
+		}
+		if (accumulator >= FIXED_TIMESTEP) {
+			// after a hitch the game slows down instead of taking one huge step
+			droppedSteps += (int)(accumulator / FIXED_TIMESTEP);
+			accumulator = fmod(accumulator, (double)FIXED_TIMESTEP);
+		}
+		// headless frames show the latest step, as they did before interpolation
+		alpha = options.headless ? 1.0f : (float)(accumulator / FIXED_TIMESTEP);
+		if (mode != previousMode) {
+			screenDirty = true;
+		}
+		if (options.headless && ++frameIndex >= options.frames) {
+			done = true;
+		}
+	}
+	renderThread.Stop();
+	frameCapture.Stop();
+	if (options.capturePath != nullptr) {
+		cout << "capture: " << frameCapture.frames << " frames, " << (frameCapture.frames > 0 ? (double)frameCapture.captureTicks * 1000.0 / SDL_GetPerformanceFrequency() / frameCapture.frames : 0.0) << " ms per frame on the render side, " << frameCapture.encoderWaits << " waits on the encoder" << endl;
+	}
+	if (options.headless && frameIndex > 0) {
+		RunReport report = gatherRunReport(options, frameIndex, renderTicks, simulationTicks, simulationSteps, droppedSteps, gridMisses);
+		printRunReport(report, cout);
+		passed = checkRunReport(report, options, cout);
 	}
 	Mix_FreeChunk(jumpSound);
 	Mix_FreeChunk(shootSound);
 	Mix_FreeChunk(deadSound);
 	Mix_FreeMusic(Background);
+	tileMesh.Cleanup();
+	if (useShaderTiles) {
+		shaderTileMap.Cleanup();
+		resources.ReleaseProgram(shaderTileMap.program);
+	}
+	renderQueue.Cleanup();
+	offscreen.Cleanup();
+	resolutionScaler.Cleanup();
+	Mesh::CleanupShared();
+	resources.ReleaseTexture(atlasTexture);
+	resources.ReleaseProgram(program);
+	resources.Cleanup();
 	SDL_Quit();
-	return 0;
+	return passed ? 0 : 1;
 }
 
 
@@ -0,0 +1,18 @@
+uniform sampler2D animationTable;
+uniform vec2 animationTableSize;
+uniform float animationTime;
+
+// Linked into every fragment shader that draws tiles, which declare it and call it with
+// a tile to get the tile showing in its place at animationTime.
+// First texel of a tile's row: frame count and centiseconds per frame, then the frame tiles.
+float animatedTile(float tile) {
+	vec4 info = texture2D(animationTable, vec2(0.5, tile + 0.5) / animationTableSize);
+	float frames = floor(info.r * 255.0 + 0.5);
+	if (frames < 2.0) {
+		return tile;
+	}
+	float duration = floor(info.a * 255.0 + 0.5) / 100.0;
+	float frame = mod(floor(animationTime / duration), frames);
+	vec4 texel = texture2D(animationTable, vec2(frame + 1.5, tile + 0.5) / animationTableSize);
+	return floor(texel.r * 255.0 + 0.5) + floor(texel.a * 255.0 + 0.5) * 256.0;
+}
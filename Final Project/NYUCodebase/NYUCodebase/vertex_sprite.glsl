@@ -0,0 +1,32 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+attribute vec4 tint;
+attribute float textured;
+attribute vec4 instanceRect;
+attribute vec4 instanceTexRect;
+attribute vec4 texCell;
+attribute float tile;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 texCoordVar;
+varying vec4 texCellVar;
+varying vec4 tintVar;
+varying float texturedVar;
+varying float tileVar;
+
+void main()
+{
+	// instanceRect and instanceTexRect default to (0, 0, 1, 1) outside of instanced draws,
+	// tint to white, textured to 1 and tile to 0 for meshes that do not carry them
+	vec4 localPosition = vec4(position.xy * instanceRect.zw + instanceRect.xy, position.zw);
+	vec4 p = viewMatrix * modelMatrix  * localPosition;
+	texCoordVar = texCoord * instanceTexRect.zw + instanceTexRect.xy;
+	texCellVar = texCell;
+	tintVar = tint;
+	texturedVar = textured;
+	tileVar = tile;
+	gl_Position = projectionMatrix * p;
+}
@@ -1,15 +1,22 @@
 attribute vec4 position;
 attribute vec2 texCoord;
+attribute vec4 instanceRect;
+attribute vec4 instanceTexRect;
+attribute vec4 texCell;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
 varying vec2 texCoordVar;
+varying vec4 texCellVar;
 
 void main()
 {
-	vec4 p = viewMatrix * modelMatrix  * position;
-    texCoordVar = texCoord;
+	// instanceRect and instanceTexRect default to (0, 0, 1, 1) outside of instanced draws
+	vec4 localPosition = vec4(position.xy * instanceRect.zw + instanceRect.xy, position.zw);
+	vec4 p = viewMatrix * modelMatrix  * localPosition;
+    texCoordVar = texCoord * instanceTexRect.zw + instanceTexRect.xy;
+	texCellVar = texCell;
 	gl_Position = projectionMatrix * p;
 }
\ No newline at end of file
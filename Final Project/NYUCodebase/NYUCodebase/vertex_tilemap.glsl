@@ -0,0 +1,15 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 tileCoordVar;
+
+void main()
+{
+	// texCoord carries map coordinates in tiles: x to the right, y down from the top row
+	tileCoordVar = texCoord;
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * position;
+}